@@ -43,29 +43,29 @@ namespace{
             objp.push_back(cv::Point3f(j,i,0));
         }
 
-        // Extracting path of individual image stored in a given directory
-        std::vector<cv::String> imagesL, imagesR;
-        // Path of the folder containing checkerboard images
+        // Path of the folder containing checkerboard images,
+        //   L/R decoded ahead and paired by index.
         std::string pathL = sDir + "/L/*.jpg";
         std::string pathR = sDir + "/R/*.jpg";
-
-        cv::glob(pathL, imagesL);
-        cv::glob(pathR, imagesR);
+        auto p_seq = vsn::ImgSeq::create(pathL, {}, pathR);
+        if(p_seq==nullptr)
+            return false;
 
         cv::Mat frameL, frameR, grayL, grayR;
         // vector to store the pixel coordinates of detected checker board corners 
         std::vector<cv::Point2f> corner_ptsL, corner_ptsR;
         bool successL, successR;
-        int N = imagesL.size();
-        assert(N<=imagesR.size());
+        int N = p_seq->size();
         log_e(to_string(N) + " images L/R pair found in:"+sDir);
-        // Looping over all the images in the directory
-        for(int i{0}; i<N; i++)
+        // Looping over all the images in the directory,
+        //   unreadable pairs skipped by readLR().
+        Sp<vsn::Img> pL, pR;
+        while(p_seq->readLR(pL, pR))
         {
-            frameL = cv::imread(imagesL[i]);
+            frameL = ImgCv(*pL).raw();
             cv::cvtColor(frameL,grayL,cv::COLOR_BGR2GRAY);
 
-            frameR = cv::imread(imagesR[i]);
+            frameR = ImgCv(*pR).raw();
             cv::cvtColor(frameR,grayR,cv::COLOR_BGR2GRAY);
 
             //---- enhance
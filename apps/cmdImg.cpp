@@ -21,7 +21,7 @@ namespace{
     namespace picker{
         struct UserDt{
             Sp<Img> p_im = nullptr;
-            Sp<Img> p_imh = nullptr; // hsv
+            Sp<const Img> p_imh = nullptr; // hsv
             string sWin;
 
         };
@@ -102,8 +102,7 @@ bool CmdImg::run_picker(CStrs& args)
     string sWin = sf;
     UserDt ud; 
     ud.p_im = p_im;
-    ud.p_imh = p_im->copy(); 
-    ud.p_imh->toHsv();
+    ud.p_imh = p_im->as(Img::ClrSpc::HSV);
     ud.sWin = sWin;
 
     cv::namedWindow(sWin);//declaring window to show image//
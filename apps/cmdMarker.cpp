@@ -27,6 +27,7 @@ CmdMarker::CmdMarker():
     {
         string sH = "detect marker and pose estimate \n";
         sH += "   Usage:pose img=<FILE> cfg=<FILE_CFG> camc=<FILE_CAM_CFG wdir=<WDIR>\n";
+        sH += "         video=<FILE> [stride=<N>|fps=<TARGET_FPS>] [dec=<1|2|4|8>]\n";
         add("pose", mkSp<Cmd>(sH,
         [&](CStrs& args)->bool{ return run_pose(args); }));
     }
@@ -69,6 +70,16 @@ bool CmdMarker::run_pose(CStrs& args)
         if(s!="")
             cfg_.skip_frm = std::stoi(s);
     }
+    //---- frame decimation, video only
+    {
+        auto& rd = cfg_.rd;
+        string s = lookup(kv, "stride");
+        if(s!="" && !s2d(s, rd.stride)) return false;
+        s = lookup(kv, "fps");
+        if(s!="" && !s2d(s, rd.fps)) return false;
+        s = lookup(kv, "dec");
+        if(s!="" && !s2d(s, rd.dec)) return false;
+    }
     //--- strange video upside down issue
     string srot = lookup(kv, "rot");
     if(srot!="")
@@ -115,7 +126,11 @@ bool CmdMarker::run_pose_img(CStr& sf)
 bool CmdMarker::run_pose_video(CStr& sf)
 {
  
-    auto pv = Video::open(sf);
+    //---- decode overlaps pose estimation
+    Video::Cfg vc;
+    vc.async.en = true;
+    vc.rd = cfg_.rd;
+    auto pv = Video::open(sf, vc);
     if(pv==nullptr)
         return false;
      //------------
@@ -124,27 +139,30 @@ bool CmdMarker::run_pose_video(CStr& sf)
      {
         FPath p(sf);
         string sfw = cfg_.swd +"/" +p.base + p.ext;
-        pw = Video::create(sfw, pv->cfg_);
+        auto vc = pv->cfg_;
+        vc.fps /= vc.rd.stride;
+        vc.wr.async = true; // frames are fresh per read
+        pw = Video::create(sfw, vc);
      }
      //------------
     // handle video
     //------------
     bool ok = true;
-    int i=0;
+    //---- skip through the frame index
+    if(cfg_.skip_frm>0)
+        if(!pv->seek(cfg_.skip_frm))
+            return false;
     while(1)
     {
-        i++;
         vector<Marker> ms;
 
         auto p=pv->read();
-     //   if(i<cfg_.skip_frm) 
-    //        continue;
+        if(p==nullptr)break;
         //---- rot
         if(cfg_.rot!=0.0)
             p->rot(cfg_.rot);
         //auto p = pi->copy();
-        if(p==nullptr)break;
-        log_i("-- Video Frame:"+to_string(i));
+        log_i("-- Video Frame:"+to_string(p->frm.idx+1));
         ok &= pose_est(*p, ms);
         //--- write to video
         if(pw!=nullptr)
@@ -157,6 +175,8 @@ bool CmdMarker::run_pose_video(CStr& sf)
         }
             
     }
+    if(pw!=nullptr)
+        pw->close();
     return ok;    
 }
 
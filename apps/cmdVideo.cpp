@@ -22,6 +22,7 @@ CmdVideo::CmdVideo():
         string sH = "frame by frame examine and operations \n";
         sH += "   Usage: frames file=<FILE> idx=<IDX> wdir=<WDIR> [-ui]\n";
         sH += "       Notes - <IDX> can set 'all' \n";
+        sH += "             - stride=<N> keeps every N-th frame \n";
         sH += "             - in '-ui' mode, 's' key to save frm  \n";
         add("frames", mkSp<Cmd>(sH,
         [&](CStrs& args)->bool{ return run_frames(args); }));
@@ -37,10 +38,19 @@ CmdVideo::CmdVideo():
     //---- 'encode'
     {
         string sH = "encode video from images\n";
-        sH += "   Usage: encode dir=<IMG_DIR> wfile=<VIDEO_FILE> \n";
+        sH += "   Usage: encode dir=<IMG_DIR> wfile=<VIDEO_FILE> [codec=<FOURCC|raw>]\n";
+        sH += "       Notes - codec default MJPG, FFV1 lossless (.avi/.mkv)\n";
         add("enc", mkSp<Cmd>(sH,
         [&](CStrs& args)->bool{ return run_enc(args); }));
     }
+    //---- 'pack'
+    {
+        string sH = "pack image sequence into raw frame file (.vfrm)\n";
+        sH += "   Usage: pack dir=<IMG_GLOB> [dirR=<IMG_GLOB>] filew=<FILE.vfrm> [-gray]\n";
+        sH += "       Notes - dirR for stereo L/R, paired by file index\n";
+        add("pack", mkSp<Cmd>(sH,
+        [&](CStrs& args)->bool{ return run_pack(args); }));
+    }
 }
 
 //------
@@ -67,15 +77,38 @@ bool CmdVideo::run_frames(CStrs& args)
         << "', idx" << s_idx 
         << ", write to '" << s_wd <<"'..." << endl;
 
-    //----
-    auto pv = vsn::Video::open(sf);
+    //---- skipped frames not decoded
+    Video::Cfg vc;
+    string s_st = lookup(kv, string("stride"));
+    if(s_st!="" && !s2d(s_st, vc.rd.stride))
+    {
+        log_e("  Invalid stride:"+s_st);
+        return false;
+    }
+    auto pv = vsn::Video::open(sf, vc);
     if(pv==nullptr) return false;
     auto& vd = *pv;
     Sp<Img> p = nullptr;
     auto& fi = data_.frm_idx;
+    //---- jump to frame idx (1 based) through
+    //   the index, single frame done directly.
+    if(idx>0)
+    {
+        if(!vd.seek(idx-1))
+            return false;
+        fi = idx-1;
+        if(!b_ui)
+        {
+            p = vd.read();
+            if(p==nullptr) return false;
+            fi++;
+            p->show(sf);
+            return save_frm(*p);
+        }
+    }
     while((p=vd.read())!=nullptr)
     {
-        fi++;
+        fi = p->frm.idx + 1;
         auto& im = *p;
         im.show(sf);
 
@@ -144,7 +177,10 @@ bool CmdVideo::run_crop(CStrs& args)
         return false;
     }
         
-    auto p_vd = vsn::Video::open(sf);
+    //---- decode overlaps crop and encode
+    Video::Cfg vc;
+    vc.async.en = true;
+    auto p_vd = vsn::Video::open(sf, vc);
     if(p_vd==nullptr)
         return false;
     auto& vd = *p_vd;
@@ -176,6 +212,7 @@ bool CmdVideo::run_crop(CStrs& args)
 
     auto wvc = vd.cfg_;
     wvc.sz = sz;
+    wvc.wr.async = true;
     auto p_vdw = Video::create(sfw, wvc);
     if(p_vdw==nullptr)
     {
@@ -214,28 +251,40 @@ bool CmdVideo::run_enc(CStrs& args)
     StrTbl kv;   parseKV(args, kv);
     string sdir = lookup(kv, string("dir"));
     string sfw  = lookup(kv, string("filew"));
-    //--- all imgs
-    vector<string> sfs;
-    cv::glob(sdir, sfs);
-    //---- get first
-    if(sfs.size()==0)
+    //--- all imgs, decoded ahead
+    auto p_seq = ImgSeq::create(sdir);
+    if(p_seq==nullptr)
     { log_e("  No img found"); return false; }
-    auto p_im0 = Img::loadFile(sfs[0]);
-    assert(p_im0!=nullptr);
-    Sz sz = p_im0->size();
+    Sz sz = p_seq->cfg_.sz;
         
     //---- creat video
     Video::Cfg vc{sz, 30};
+    vc.wr.async = true;
+    string scdc = lookup(kv, string("codec"));
+    if(scdc!="") vc.wr.codec = scdc;
     auto p_vd = Video::create(sfw, vc);
     if(p_vd==nullptr) 
         return false;
-    for(auto& sf : sfs)
-    {
-        auto p = Img::loadFile(sf);
+    Sp<Img> p = nullptr;
+    while((p=p_seq->read())!=nullptr)
         p_vd->write(*p);
-
-    }
     p_vd->close();
     return true;
 }
-
+//------
+bool CmdVideo::run_pack(CStrs& args)
+{
+    StrTbl kv;   parseKV(args, kv);
+    string sdir  = lookup(kv, string("dir"));
+    string sdirR = lookup(kv, string("dirR"));
+    string sfw   = lookup(kv, string("filew"));
+    if(sdir=="" || sfw=="")
+    { log_e("  dir and filew required"); return false; }
+    ImgSeq::Cfg sc;
+    if(has(kv, "-gray"))
+        sc.cvFlag = cv::IMREAD_GRAYSCALE;
+    auto p_seq = ImgSeq::create(sdir, sc, sdirR);
+    if(p_seq==nullptr)
+        return false;
+    return FrmPack::convert(*p_seq, sfw, sdirR!="");
+}
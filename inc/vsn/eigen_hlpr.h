@@ -20,6 +20,11 @@ namespace egn{
 
     using vec3s = vector<vec3>;
     using vec2s = vector<vec2>;
+    //---- single precision, batch APIs
+    using vec2f = Eigen::Vector2f;
+    using vec3f = Eigen::Vector3f;
+    using vec2fs = vector<vec2f>;
+    using vec3fs = vector<vec3f>;
     extern string jstr(const vec2s& vs);
 
     using mat2 = Eigen::Matrix2d;
@@ -203,6 +203,10 @@ namespace vsn{
     extern int cv_waitkey(int MS);
     extern bool cv_waitESC(int MS);
     extern void show_loop();
+    //---- split [0, N) into ranges run on
+    //   all cores (OpenCV thread pool).
+    extern void parallel_for(int N, 
+        const function<void(int i0, int i1)>& f);
     //----
     //---------
     // cam
@@ -239,7 +243,25 @@ namespace vsn{
 
             string str()const;
         };
+        //---- batched over contiguous arrays, on
+        //   fx,fy,cx,cy and D directly. bDist 
+        //   applies D as OpenCV (k1,k2,p1,p2,k3).
+        //   z==0 points give (0,0) as proj().
+        void proj(const vec3s& Ps, vec2s& vs, bool bDist=false)const;
+        void proj(const vec3fs& Ps, vec2fs& vs, bool bDist=false)const;
+        // pixels to unit focal plane, no undistortion
+        void backProj(const vec2s& vs, vec3s& Ps)const;
+        void backProj(const vec2fs& vs, vec3fs& Ps)const;
+        // normalized coords, in place
+        void distort(vec2s& ns)const;
+        void distort(vec2fs& ns)const;
+        void proj(const vector<Line>& ls, vector<Line2d>& l2s,
+                  bool bDist=false)const;
         //---- functions
+        // undistorted pixels appended to vs. Bilinear
+        //   lookup in a grid of lut_step px, built 
+        //   once per K/D/sz. Iterative solve for 
+        //   points off the grid, or lut_step 0.
         void undis(const vec2s& vds, vec2s& vs)const;
         bool toLense(Lense& l)const;
     
@@ -250,6 +272,12 @@ namespace vsn{
         Dist D; 
         //---- camera dimention
         Sz sz; 
+        //---- undistortion lookup, shared by
+        //   copies, rebuilt if K/D/sz change.
+        int lut_step = 8;
+        struct Lut;
+        mutable Sp<Lut> p_lut_ = nullptr;
+        Sp<Lut> lut()const;
 
     };
     //---- streamming
@@ -263,6 +291,27 @@ namespace vsn{
         Pose pose_;
     };
 
+    //------------
+    // pixel layout
+    //------------
+    // element depth, same order as OpenCV
+    enum class PxDepth{ U8=0, S8, U16, S16, S32, F32, F64 };
+    //---- pixel type to channels / depth
+    template<typename T> struct PxTraits;
+    template<int C, PxDepth D> struct PxTraitsB
+    { static constexpr int chn = C; 
+      static constexpr PxDepth depth = D; };
+    template<> struct PxTraits<uint8_t> : PxTraitsB<1, PxDepth::U8>{};
+    template<> struct PxTraits<int8_t>  : PxTraitsB<1, PxDepth::S8>{};
+    template<> struct PxTraits<uint16_t>: PxTraitsB<1, PxDepth::U16>{};
+    template<> struct PxTraits<int16_t> : PxTraitsB<1, PxDepth::S16>{};
+    template<> struct PxTraits<int32_t> : PxTraitsB<1, PxDepth::S32>{};
+    template<> struct PxTraits<float>   : PxTraitsB<1, PxDepth::F32>{};
+    template<> struct PxTraits<double>  : PxTraitsB<1, PxDepth::F64>{};
+    template<> struct PxTraits<BGR>     : PxTraitsB<3, PxDepth::U8>{};
+    template<> struct PxTraits<HSV>     : PxTraitsB<3, PxDepth::U8>{};
+    template<typename T> struct PxTraits<const T> : PxTraits<T>{};
+
     //------------
     // Img
     //------------
@@ -271,6 +320,9 @@ namespace vsn{
         typedef shared_ptr<Img> Ptr;
         typedef shared_ptr<const Img> CPtr;
         static Sp<Img> create(); // factory
+        //---- allocated from ImgPool
+        static Sp<Img> create(const Sz& sz, int chn=3, 
+                              PxDepth d=PxDepth::U8);
 
         virtual Sz size()const=0;
         virtual bool load(CStr& s, int cvFlag=1)=0;
@@ -315,13 +367,66 @@ namespace vsn{
         virtual void scale(const Sz& sz, int method=1)=0;
         void scale(float s, int method=1)
         { Sz sz=size(); scale(Sz(sz.w*s, sz.h*s), method); }
+        //---- colour space tag. UNKNOWN is taken as
+        //   BGR for 3 channels, GRAY for 1 channel.
+        enum class ClrSpc{ UNKNOWN=0, BGR, GRAY, HSV };
+        virtual ClrSpc clrSpc()const=0;
+        virtual void setClrSpc(ClrSpc c)=0;
+        // toGray/toHsv are no-ops if already there,
+        //   and reuse cached conversions otherwise.
         virtual void toGray()=0;
         virtual void toHsv()=0;
+        //---- converted view, memoised until the next
+        //   write. Shares pixels with the cache, 
+        //   read only. Concurrent as() on one Img is
+        //   safe, concurrent writes are not.
+        virtual Sp<const Img> as(ClrSpc c)const=0;
+        //---- pixel version, bumped by every write 
+        //   through Img calls. Call touch() after 
+        //   writing through data()/buf()/ImgView.
+        virtual uint32_t ver()const=0;
+        virtual void touch()=0;
         virtual void blur(int w)=0;
         //----
         //---- internal storage data (Mat)
         virtual void* data()=0;
         virtual const void* data()const=0;
+        //---- raw pixel buffer, see ImgView.
+        //   CBuf of a const Img is read only.
+        template<typename P>
+        struct BufT{
+            P* p = nullptr;
+            int w=0, h=0;
+            size_t step = 0; // bytes per row
+            int chn = 0;
+            PxDepth depth = PxDepth::U8;
+        };
+        using Buf  = BufT<uint8_t>;
+        using CBuf = BufT<const uint8_t>;
+        virtual Buf buf()=0;
+        virtual CBuf buf()const=0;
+        //---- zero-copy wrap of caller owned pixels.
+        //   release() runs once the last Img sharing
+        //   the buffer drops, crop() views included.
+        //   onRealloc(sOp) runs when an op can't work
+        //   in place and moves the Img off the buffer.
+        //   It fires after sOp: the Img already holds
+        //   new pixels, the buffer is left as before
+        //   sOp and not written again.
+        struct Ext{
+            Buf buf; // step 0 : packed rows
+            function<void()> release = nullptr;
+            function<void(CStr& sOp)> onRealloc = nullptr;
+        };
+        static Sp<Img> wrap(const Ext& e);
+        //---- map raw pixels of file at byte ofs,
+        //   b.p ignored. wr=false maps copy-on-write, 
+        //   in place ops never touch the file.
+        static Sp<Img> mapFile(CStr& sf, const Buf& b, 
+                               size_t ofs=0, bool wr=false);
+        //---- same, POSIX shared memory object.
+        static Sp<Img> mapShm(CStr& sName, const Buf& b, 
+                              size_t ofs=0, bool wr=false);
         //--- Suggest undistortion at very beginning
         virtual void undistort(const CamCfg& cc)=0;
         virtual Sp<Img> copy()const =0;
@@ -330,6 +435,12 @@ namespace vsn{
         virtual void rot(double dgr)=0;
         //---- 
         static Sp<Img> loadFile(const string& sf, int cvFlags=1);
+        //---- source frame info, set by Video::read()
+        struct FrmInfo{
+            int64_t seq = -1; // decoded order, gaps on drop
+            int64_t idx = -1; // frame number in source
+            double  t = 0;    // sec, source pts or clock
+        }; FrmInfo frm;
 
         //---- Hough line detection
         struct HoughLnCfg{
@@ -354,6 +465,123 @@ namespace vsn{
         virtual vector<Circle> det(const HoughCirCfg& c)const=0;
     protected:
     };
+    //------------
+    // ImgPool
+    //------------
+    // Recycles pixel buffers keyed by size and 
+    //   type. Backs Img::create(sz,..), Img::copy()
+    //   and Video::read(); a buffer returns to the 
+    //   pool when the last Img referencing it drops.
+    struct ImgPool{
+        struct Cfg{
+            bool en = true;
+            // max idle bytes kept in pool
+            size_t maxIdle = size_t(512) << 20;
+        };
+        struct Stats{
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t bytesIdle = 0;
+            size_t bytesUsed = 0;
+            string str()const;
+        };
+        static void setCfg(const Cfg& c);
+        static Cfg getCfg();
+        static Stats stats();
+        // free all idle buffers
+        static void clear();
+    };
+
+    //------------
+    // ImgView
+    //------------
+    // Typed row access to Img pixels, type and 
+    //   channels checked once on creation, 
+    //   invalid view (val() false) on mismatch.
+    //   e.g.: ImgView<BGR> v(im); v.row(y)[x].r=255;
+    //   A const Img only gives a ConstImgView.
+    template<typename T, typename B>
+    class ImgViewT{
+    public:
+        template<typename I>
+        ImgViewT(I& im){
+            auto b = im.buf();
+            using Tr = PxTraits<T>;
+            if(b.chn!=Tr::chn || b.depth!=Tr::depth)
+            {
+                log_e("ImgView: pixel type mismatch, chn="+
+                        to_string(b.chn)+", depth="+
+                        to_string((int)b.depth));
+                return;
+            }
+            p_ = b.p; w_ = b.w; h_ = b.h; step_ = b.step;
+        }
+        bool val()const{ return p_!=nullptr; }
+        int w()const{ return w_; }
+        int h()const{ return h_; }
+        size_t step()const{ return step_; }
+        T* row(int y)const
+        { return reinterpret_cast<T*>(p_ + y*step_); }
+        T& at(int x, int y)const{ return row(y)[x]; }
+    protected:
+        B* p_ = nullptr;
+        int w_=0, h_=0;
+        size_t step_ = 0;
+    };
+    template<typename T>
+        using ImgView = ImgViewT<T, uint8_t>;
+    template<typename T>
+        using ConstImgView = ImgViewT<const T, const uint8_t>;
+    //---- f(y, T* row), rows in parallel
+    template<typename V, typename F>
+        void forEachRow(const V& v, F f)
+        {
+            parallel_for(v.h(), [&](int y0, int y1){
+                for(int y=y0;y<y1;y++) f(y, v.row(y));
+            });
+        }
+    //---- f(T& px), rows in parallel
+    template<typename V, typename F>
+        void forEachPixel(const V& v, F f)
+        {
+            int W = v.w();
+            forEachRow(v, [&](int y, auto* r){
+                for(int x=0;x<W;x++) f(r[x]);
+            });
+        }
+    //------------
+    // ImgOps
+    //------------
+    // Deferred Img processing chain, calls only
+    //   record. run() fuses the chain into passes:
+    //   adjacent geometric ops (scale/rot/undistort)
+    //   compose into one cached remap, per-pixel ops
+    //   after them (toGray/toHsv/filter/blur) run on
+    //   the resampled rows in the same pass, band by 
+    //   band in parallel. A per-pixel op followed by
+    //   a geometric op starts a new pass.
+    //   e.g.: ops->scale(sz).toGray().blur(5);
+    //         auto p = ops->run(*pi);
+    class ImgOps{
+    public:
+        static Sp<ImgOps> create();
+        virtual ImgOps& scale(const Sz& sz, int method=1)=0;
+        virtual ImgOps& rot(double dgr)=0;
+        virtual ImgOps& undistort(const CamCfg& cc)=0;
+        virtual ImgOps& toGray()=0;
+        virtual ImgOps& toHsv()=0;
+        virtual ImgOps& filter(const HSV& c0, const HSV& c1)=0;
+        virtual ImgOps& blur(int w)=0;
+        virtual void clear()=0;
+        virtual size_t size()const=0;
+        // number of passes run() takes
+        virtual int N_pass()const=0;
+        //---- materialise on im, output from ImgPool.
+        //   remap cached per input size, so reuse 
+        //   the same ImgOps over video frames.
+        virtual Sp<Img> run(const Img& im)=0;
+    };
+
     //-------------
     // video
     //-------------
@@ -363,15 +591,171 @@ namespace vsn{
         struct Cfg{
             Sz sz;
             float fps=30;
+            //---- read side, decoder thread fills
+            //   a ring of N_ring frames so decode 
+            //   overlaps processing.
+            struct Async{
+                bool en = false;
+                int N_ring = 4;
+                // when ring full: 0 block decoder,
+                //   1 drop oldest, 2 latest only.
+                int policy = 0;
+            }; Async async;
+            //---- read side decimation, skipped frames
+            //   are grab() only, no retrieve or colour
+            //   conversion. Img::frm.idx stays the
+            //   source frame number.
+            struct Rd{
+                int stride = 1;
+                // target fps, stride from source
+                //   fps, 0 off. Overrides stride.
+                float fps = 0;
+                // size 1/dec (1,2,4,8), decoder level
+                //   where backend allows, else resized.
+                int dec = 1;
+            }; Rd rd;
+            //---- write side
+            struct Wr{
+                // fourcc, or "raw" uncompressed,
+                //   "FFV1" lossless (.avi/.mkv)
+                string codec = "MJPG";
+                bool color = true;
+                // encode on own thread, write() queues 
+                //   the frame by reference: do not
+                //   modify it afterwards.
+                bool async = false;
+                int N_queue = 8;
+            }; Wr wr;
         };
-
-        static Sp<Video> open(CStr& s);
+        // sz/fps of c filled from the source
+        static Sp<Video> open(CStr& s, const Cfg& c);
+        static Sp<Video> open(CStr& s){ return open(s, Cfg()); }
         static Sp<Video> create(CStr& sf, const Cfg& cfg);
         virtual Sp<Img> read()=0;
         virtual bool write(const Img& im)=0;
+        // flush queued frames, release
         virtual void close()=0;
+        //---- random access, i 0 based. next read()
+        //   returns frame i, Img::frm.idx exact.
+        virtual bool seek(int64_t i)
+        { log_e("Video: seek not supported"); return false; }
+        Sp<Img> readAt(int64_t i)
+        { return seek(i) ? read() : nullptr; }
+        // total frames, -1 unknown
+        virtual int64_t N_frms()const{ return -1; }
         Cfg cfg_;
     };
+    //------------
+    // ImgSeq
+    //------------
+    // Image files as a Video source, decoded 
+    //   ahead on worker threads into a bounded
+    //   reorder buffer, read() returns in order.
+    //   sL/sR are glob patterns. With sR, readLR()
+    //   pairs L/R by the number in the file name 
+    //   (position in list if names have none).
+    class ImgSeq : public Video{
+    public:
+        struct Cfg{
+            Cfg(){}
+            int start  = 0;  // frame range in sorted
+            int end    = -1; //   list, end exclusive,
+            int stride = 1;  //   -1 till the end.
+            int N_thd  = 4;  // decode threads
+            int N_buf  = 16; // max frames decoded ahead
+            int cvFlag = 1;  // imread flag
+            // size 1/dec (1,2,4,8), reduced JPEG
+            //   decode for gray/colour cvFlag.
+            int dec = 1;
+        };
+        static Sp<ImgSeq> create(CStr& sL, 
+                                 const Cfg& c=Cfg(),
+                                 CStr& sR="");
+        // left img only, nullptr at end. Unreadable
+        //   files are logged and skipped.
+        virtual Sp<Img> read()=0;
+        virtual bool readLR(Sp<Img>& pL, Sp<Img>& pR)=0;
+        // total frames after range/stride
+        virtual int size()const=0;
+        // file name number of the last read frame
+        virtual int frmIdx()const=0;
+        virtual string sFile()const=0;
+        virtual bool write(const Img& im)override
+        { log_e("ImgSeq: write not supported"); 
+          return false; }
+    };
+    //------------
+    // FrmPack
+    //------------
+    // Uncompressed frame container (.vfrm) for 
+    //   repeated dataset runs: header, page-aligned
+    //   frames of one layout (1 or 2 sides per entry 
+    //   for L/R), index at the end. Read through 
+    //   mmap, frames are zero-copy Imgs, each on its
+    //   own copy-on-write mapping: in place ops on
+    //   one frame Img stay private to it.
+    class FrmPack : public Video{
+    public:
+        static Sp<FrmPack> open(CStr& sf);
+        virtual Sp<Img> read()=0;
+        virtual bool readLR(Sp<Img>& pL, Sp<Img>& pR)=0;
+        virtual int size()const=0;
+        virtual int N_side()const=0;
+        // file number of the last entry read
+        virtual int frmIdx()const=0;
+        virtual bool write(const Img& im)override
+        { log_e("FrmPack: use FrmPack::Writer"); 
+          return false; }
+        //---- writer, layout from the first add()
+        class Writer{
+        public:
+            ~Writer(){ close(); }
+            bool open(CStr& sf, int N_side=1);
+            bool add(const Img& im, const Img* p_imR=nullptr,
+                     int idx=-1);
+            // writes index, patches header
+            bool close();
+        protected:
+            std::ofstream ofs_;
+            string sf_;
+            int N_side_ = 1;
+            int clrSpc_ = 0;
+            Img::CBuf lay_; // p unused
+            vector<uint64_t> ofss_;
+            vector<int> idxs_;
+            bool addImg(const Img& im);
+        };
+        //---- ImgSeq L(/R) to pack file
+        static bool convert(ImgSeq& seq, CStr& sfw, bool bLR);
+    };
+
+    //------------
+    // StereoVideo
+    //------------
+    // Side-by-side stereo source over any Video
+    //   (file, ImgSeq, FrmPack). L/R are ROI views
+    //   into the one decoded frame, no copy. With
+    //   enUndist each side is undistorted by its 
+    //   own CamCfg through maps built once, into
+    //   pooled buffers, ready for StereoVO::onImg().
+    class StereoVideo{
+    public:
+        struct Cfg{
+            Cfg(){}
+            // L/R rect in frame, zero size : halves
+            ut::Rect rL, rR;
+            bool enUndist = false;
+            CamCfg camL, camR;
+        };
+        static Sp<StereoVideo> open(CStr& s, 
+                                    const Cfg& c=Cfg(),
+                                    const Video::Cfg& vc=Video::Cfg());
+        static Sp<StereoVideo> create(Sp<Video> p_vd, 
+                                      const Cfg& c=Cfg());
+        // false at end or error
+        virtual bool read(Sp<Img>& pL, Sp<Img>& pR)=0;
+        virtual Sp<Video> video()const=0;
+    };
 
     //----------
     // InstSegm 
@@ -392,13 +776,46 @@ namespace vsn{
             // in case color filter around red,
             //   Hue shift 90 degree
             bool enHueShift90 = false;
+            //---- Named color classes (max 8), 
+            //   segmented in one pass. If empty,
+            //   'filter' is the only class.
+            struct Cls{
+                string sName;
+                Filter filter;
+                bool enHueShift90 = false;
+            }; vector<Cls> classes;
+            // instance extraction 
+            //   0: contours of whole mask
+            //   1: connected components, culled
+            //      by area/box before contours.
+            int extract = 0;
+            //---- temporal tracking on video,
+            //   re-segment only around predicted
+            //   boxes, full frame every N_full.
+            struct Track{
+                bool en = false;
+                int N_full = 10;
+                // box dilate, ratio of box size
+                float dilate = 0.5;
+                // match gate, ratio of box diagonal
+                float matchTH = 1.0;
+                // frames to keep a missed track
+                int N_lost = 3;
+            }; Track track;
         }; Cfg cfg_;
         //----
         struct Inst{
             vector<vec2> hull;
             ut::Rect box;
+            int cls = 0; // index of color class
+            // persistent id if tracking enabled
+            int id = -1;
+            // box center velocity, pixel/frame
+            vec2 vel = zerov2();
         };
         //----
+        // Note: intermediate imgs are only
+        //   allocated if en_imo or enShow.
         struct Data{
             vector<Inst> ins;
             Sp<Img> p_imo = nullptr;
@@ -408,9 +825,26 @@ namespace vsn{
             Sp<Img> p_imc = nullptr;
             // threshold result
             Sp<Img> p_imt = nullptr;
+            // label img, 0:none, k+1:class k
+            Sp<Img> p_iml = nullptr;
         }; Data data_;
         bool onImg(const Img& im);
-
+        // drop tracked instances
+        void resetTrack(){ trk_ = TrkDt(); }
+    protected:
+        //---- tracking state across frames
+        struct TrkDt{
+            int frmIdx = 0;
+            int nextId = 0;
+            // in : last observed, lost : frames
+            //   missed since.
+            struct Trk{ Inst in; int lost = 0; };
+            vector<Trk> ins;
+        }; TrkDt trk_;
+        void track(vector<Inst>& ins);
+        // dilated predicted boxes to search,
+        //   empty for full frame pass.
+        vector<ut::Rect> track_rgns()const;
     };
 
     //-----------
@@ -545,18 +979,84 @@ namespace vsn{
                 string sName;
                 Color bk_color;
                 float axisL=10.0;
+                // spin() event/render budget
+                int spinMS = 100;
+                // level of detail, clouds shown 
+                //   decimated to N_max, 0 all.
+                size_t N_max = 0;
             }; 
+            Cfg cfg_;
             void add(const Points& ps, 
                      const string& sName,
                      float pnt_sz=3);
+            // in place by name, add() if new
+            void upd(const Points& ps, 
+                     const string& sName,
+                     float pnt_sz=3);
+            void remove(const string& sName);
             bool spin();
             static Sp<Vis> create(const Cfg& c=Cfg());
             void clear();
         };
         //----
         void add(const Pnt& p);
+        size_t size()const;
+        Pnt get(size_t i)const;
+        // drop all points, keeps storage
+        void clear();
+        //---- file format, fmt -1 by extension:
+        //   '.ply' PLY binary, else PCD binary.
+        //   0 PCD ascii, 1 PCD binary, 
+        //   2 PCD binary_compressed, 3 PLY binary
         bool load(const string& sf);
-        bool save(const string& sf)const;
+        bool save(const string& sf, int fmt=-1)const;
+        //---- streaming writer, per frame clouds 
+        //   appended in chunks, point count in 
+        //   header patched on close(). PCD binary,
+        //   or PLY binary for '.ply'.
+        class Writer{
+        public:
+            ~Writer(){ close(); }
+            bool open(CStr& sf);
+            bool add(const Points& ps);
+            bool add(const Pnt& p);
+            bool close();
+            size_t N()const{ return N_; }
+        protected:
+            std::ofstream ofs_;
+            string sf_;
+            bool bPly_ = false;
+            size_t N_ = 0;
+            string buf_; // pending chunk
+            bool flush();
+            string header()const;
+        };
+        //---- organised w x h grid, e.g. a point per
+        //   disparity pixel, invalid (NaN) until 
+        //   set(). filter() drops invalid points.
+        void initGrid(int w, int h);
+        void set(int u, int v, const Pnt& p);
+        bool isGrid()const;
+        //---- outlier filter. One kd-tree per call,
+        //   shared by the stats and radius tests, 
+        //   queries in parallel. Grid mode takes the
+        //   image window as neighbourhood instead,
+        //   organised clouds only.
+        struct FilterCfg{
+            FilterCfg(){}
+            int mode = 0; // 0 kd-tree, 1 grid
+            //---- statistical : mean distance to meanK
+            //   nearest within devTh std of all
+            bool enStats = true;
+            int meanK = 50;
+            float devTh = 1.0;
+            //---- radius : N_min neighbours in radius
+            bool enRadius = false;
+            float radius = 0.1;
+            int N_min = 5;
+            int win = 7; // grid mode window
+        };
+        void filter(const FilterCfg& c);
         //--- filter statistical or voxel
         void filter_stats(float meanK = 50, float devTh = 1.0);
         void filter_voxel(float reso=0.03);
@@ -569,6 +1069,68 @@ namespace vsn{
     protected:
         Sp<Data> p_data_ = nullptr;
     };
+    //------------
+    // PointMap
+    //------------
+    // Global voxel hash map, fuses per frame clouds
+    //   into world frame incrementally. Each voxel
+    //   keeps centroid, colour and count. Memory is
+    //   bounded by N_max voxels and age_max frames,
+    //   least recently updated voxels evicted first.
+    class PointMap{
+    public:
+        struct Cfg{
+            Cfg(){}
+            float reso = 0.05; // voxel size
+            int N_max = 2000000; // voxels, 0 unbounded
+            // evict voxels not updated within, 0 off
+            int age_max = 0;
+            // export voxels of at least N_min points
+            int N_min = 1;
+        };
+        static Sp<PointMap> create(const Cfg& c=Cfg());
+        // one frame, ps in camera frame, 
+        //   world P = Rw*p + tw.
+        virtual void add(const Points& ps, 
+                         const mat3& Rw, const vec3& tw)=0;
+        // voxel centroids with mean colour
+        virtual Sp<Points> toPoints()const=0;
+        // same into ps, reusing its storage
+        virtual void toPoints(Points& ps)const=0;
+        virtual size_t size()const=0; // voxels
+        virtual int N_frms()const=0;
+        virtual void clear()=0;
+    };
+    //------------
+    // Tsdf
+    //------------
+    // Voxel hashed TSDF volume. Blocks of 8^3 
+    //   voxels are allocated only within trunc of
+    //   observed depth, so memory follows surface
+    //   area. Each frame integrates the blocks 
+    //   inside the camera frustum, in parallel
+    //   across blocks, weights clamped to w_max.
+    class Tsdf{
+    public:
+        struct Cfg{
+            Cfg(){}
+            float reso  = 0.05; // voxel size
+            float trunc = 0.2;  // truncation distance
+            float w_max = 64;
+            float z_min = 0.3;  // depth range used
+            float z_max = 20;
+            int   px_step = 2;  // block allocation
+        };
+        static Sp<Tsdf> create(const Cfg& c=Cfg());
+        // imz F32 depth (z, 0 invalid), undistorted,
+        //   camera pose world P = Rw*p + tw.
+        virtual bool integrate(const Img& imz, const CamCfg& cc,
+                               const mat3& Rw, const vec3& tw)=0;
+        // zero crossings, voxels of weight >= w_min
+        virtual Sp<Points> toPoints(float w_min=1)const=0;
+        virtual size_t N_blks()const=0;
+        virtual void clear()=0;
+    };
 
     //------------
     // StereoVO
@@ -632,9 +1194,33 @@ namespace vsn{
                     float meanK = 50;
                     float devTh = 1.0;
                     float voxel_res = 0.03; 
+                    // 0 kd-tree, 1 grid (disparity pixels)
+                    int mode = 0;
+                    bool enRadius = false;
+                    float radius = 0.1;
+                    int N_min = 5;
+                    int win = 7;
                 }; Filter filter;
+                //---- dense clouds fused into global
+                //   PointMap by odom, needs enDense.
+                struct Map{
+                    bool en = false;
+                    float reso = 0.05;
+                    int N_max = 2000000;
+                    int age_max = 0;
+                }; Map map;
             }; PointCloud pntCloud;
 
+            //---- TSDF surface from depth by odom,
+            //   needs enDepth.
+            struct Tsdf{
+                bool en = false;
+                float reso = 0.05;
+                float trunc = 0.2;
+                float w_max = 64;
+                float z_max = 20;
+            }; Tsdf tsdf;
+
             //---- omnidirectional
             struct Omni{
                 // factory
@@ -651,6 +1237,9 @@ namespace vsn{
         public:
             //---- depth disparity map
             Sp<Img> p_imd_ = nullptr;
+            // pixel disparity = p_imd_ value * disp_scl,
+            //   set by the depth mode (SGBM x16 : 1/16).
+            float disp_scl = 1;
             //---- point cloud
             struct PntCloud{
                 Sp<Points> p_dense  = nullptr;
@@ -690,16 +1279,24 @@ namespace vsn{
             
             //---- current Frm result
             Sp<Frm> p_frm = nullptr;
+            //---- global dense map
+            Sp<PointMap> p_map = nullptr;
+            Sp<vsn::Tsdf> p_tsdf = nullptr;
 
             //---- vis
             struct PntVis{
 
                 Sp<Points::Vis> p_vis_dense = nullptr;
+                // map export shown, reused buffer,
+                //   frames shown since export.
+                Sp<Points> p_map = nullptr;
+                int N_mapAge = 0;
             }; PntVis pntVis;
 
             // wr data
             bool wrData();
-            void close(){ wr.close(); }
+            // map / tsdf surface saved if any
+            void close();
         };
         //----
         virtual bool onImg(const Img& im1, 
@@ -1,10 +1,14 @@
 #include "vsnLib.h"
 #include "ocv_hlpr.h"
+#include <atomic>
 
 
 namespace vsn
 {
-
+    //---- ImgPool allocator, set as 
+    //   Mat::allocator before create().
+    //   nullptr (OpenCV default) if disabled.
+    extern cv::MatAllocator* poolAlloc();
 
     //------------
     // ImgCv
@@ -13,10 +17,7 @@ namespace vsn
     struct ImgCv : public vsn::Img{
         ImgCv(){}
         ImgCv(cv::Mat& im):im_(im){};
-        ImgCv(const Img& im)
-        {  
-            im_ = *reinterpret_cast<const cv::Mat*>(im.data());
-        }
+        ImgCv(const Img& im);
 
         virtual Sz size()const override
         {  return {im_.cols,im_.rows}; }
@@ -45,8 +46,16 @@ namespace vsn
                           float w=1.0)override;
         virtual void draw(const vector<Circle>& cs, const Color& c, 
                           float w=1.0)override;
+        virtual ClrSpc clrSpc()const override{ return cs_; }
+        virtual void setClrSpc(ClrSpc c)override
+        { cs_ = c; touch(); }
         virtual void toGray()override;
         virtual void toHsv()override;
+        virtual Sp<const Img> as(ClrSpc c)const override;
+        virtual uint32_t ver()const override{ return *p_ver_; }
+        virtual void touch()override;
+        // im_ converted to c, memoised
+        cv::Mat cvt(ClrSpc c)const;
         virtual void blur(int w)override;
         virtual void filter(const HSV& c0,
                             const HSV& c1) override;
@@ -56,9 +65,13 @@ namespace vsn
         { return reinterpret_cast<void*>(&(im_)); }
         virtual const void* data()const override
         { return reinterpret_cast<const void*>(&(im_)); }
+        virtual Buf buf()override;
+        virtual CBuf buf()const override;
         virtual Sp<Img> copy()const override
         {  auto p = mkSp<ImgCv>(); 
-           im_.copyTo(p->im_); return p;  }
+           p->im_.allocator = poolAlloc();
+           im_.copyTo(p->im_); 
+           p->cs_ = cs_; p->frm = frm; return p;  }
         virtual Sp<Img> crop(const ut::Rect& r)const override;
         
         virtual void rot(double dgr)override;
@@ -69,12 +82,38 @@ namespace vsn
 
         virtual void undistort(const CamCfg& cc)override;
         cv::Mat im_;
+        //---- writes through im_/raw() need touch()
         cv::Mat raw(){ return im_; }
         cv::Mat raw()const{ return im_; }
         virtual vector<Line2d> det(const HoughLnCfg& c)const override;
         virtual vector<Circle> det(const HoughCirCfg& c)const override;
-
+        //---- Img::wrap() buffer tracking
+        void setExt(const function<void(CStr&)>& onRealloc)
+        { p_extU_ = im_.u; onRealloc_ = onRealloc; }
+        bool isExt()const
+        { return p_extU_!=nullptr && im_.u==p_extU_; }
     protected:
+        ClrSpc cs_ = ClrSpc::UNKNOWN;
+        //---- pixel version, shared by ImgCv views
+        //   of the same pixels (crop, ImgCv(Img)),
+        //   so a write through any of them drops
+        //   the cached conversions of all.
+        Sp<std::atomic<uint32_t>> p_ver_ = 
+            mkSp<std::atomic<uint32_t>>(0);
+        struct CacheDt{ uint32_t ver=0; cv::Mat im; };
+        //---- conversion cache, locked, not copied
+        struct Cache{
+            Cache(){}
+            Cache(const Cache&){}
+            Cache& operator = (const Cache&){ return *this; }
+            std::mutex mtx;
+            std::map<ClrSpc, CacheDt> m;
+        }; mutable Cache cache_;
+        void setCvt(ClrSpc c);
+        ClrSpc clrSpcEff()const;
+        const cv::UMatData* p_extU_ = nullptr;
+        function<void(CStr&)> onRealloc_ = nullptr;
+        void chkRealloc(CStr& sOp);
     };
     //---- cast utils
     //------------
@@ -85,16 +124,55 @@ namespace vsn
     public:
         VideoCv(){};
         VideoCv(CStr& s);
+        ~VideoCv(){ close(); }
         virtual Sp<Img> read()override;
         
         bool isOpen() { return cap_.isOpened(); }
         bool createWr(CStr& sf);
         virtual bool write(const Img& im)override;
         virtual void close()override;
+        bool startAsync();
+        virtual bool seek(int64_t i)override;
+        virtual int64_t N_frms()const override
+        { return pts_.empty() ? -1 : (int64_t)pts_.size(); }
 
     protected:
         cv::VideoCapture cap_;
         Sp<cv::VideoWriter> p_vwr = nullptr;
+        string sf_;
+        int64_t seq_ = 0;
+        int64_t pos_ = 0; // next frame number
+        bool bGrabbed_ = false; // pos_ grabbed, not retrieved
+        int nSkip_ = 0; // frames to grab() before next read
+        bool bResize_ = false; // Rd::dec not done by backend
+        void initRd();
+        std::chrono::steady_clock::time_point t0_;
+        Sp<Img> readCap();
+        //---- frame index, pts (ms) per frame,
+        //   cached in '<file>.vidx' sidecar.
+        vector<double> pts_;
+        bool loadIdx();
+        int64_t frmAt(double ms)const;
+        //---- async decode ring
+        struct Ring{
+            std::thread thd;
+            std::mutex mtx;
+            std::condition_variable cv;
+            std::deque<Sp<Img>> frms;
+            bool bStop = false;
+            bool bEnd = false;
+        }; Ring ring_;
+        void decodeLoop();
+        void stopAsync();
+        //---- async encode queue
+        struct WrQ{
+            std::thread thd;
+            std::mutex mtx;
+            std::condition_variable cv;
+            std::deque<cv::Mat> frms;
+            bool bStop = false;
+        }; WrQ wrq_;
+        void encodeLoop();
 
     };
 
@@ -186,6 +264,8 @@ namespace vsn
                        const set<int>& mi_ary,
                        vec3s& Ps)const;
         bool genDense(const Img& imL);
+        void updMap();
+        void updTsdf();
         void show();
 
         //----
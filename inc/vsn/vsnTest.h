@@ -17,6 +17,25 @@ namespace test{
     {
     public:
         virtual bool run() override;
+    protected:
+        bool test_cls()const;
+    };
+    //------
+    class TestImg : public Test
+    {
+    public:
+        virtual bool run() override;
+    protected:
+        bool test_rot()const;
+        bool test_ops()const;
+    };
+    //------
+    class TestCam : public Test
+    {
+    public:
+        virtual bool run() override;
+    protected:
+        bool test_undis()const;
     };
     //------
     class TestMarker : public Test
@@ -37,6 +56,7 @@ namespace test{
     protected:
         bool testKittyGray()const;
         bool test_imgLR()const;
+        bool test_sbsVideo()const;
 
     };
     //------
@@ -54,6 +74,7 @@ namespace test{
         bool test_pcl_wr();
         bool test_pcl_vis();
         bool test_basic();
+        bool test_filter();
     };
 }
 
@@ -62,6 +62,7 @@ namespace app
         bool run_frames(CStrs& args);
         bool run_crop(CStrs& args);
         bool run_enc(CStrs& args);
+        bool run_pack(CStrs& args);
         bool save_frm(const Img& im);
 
     };
@@ -79,6 +80,7 @@ namespace app
             double rot=0;
             bool enWr = false;
             int skip_frm=0;
+            Video::Cfg::Rd rd; // frame decimation
         };
         Cfg cfg_;
         //----
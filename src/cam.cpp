@@ -107,34 +107,195 @@ vec3 CamCfg::proj(const vec2& p)const
     return v;
 }
 
+//----------
+// batched
+//----------
+// AoS points mapped as 2/3 x N arrays, math on
+//   contiguous rows so Eigen vectorises it.
+namespace{
+    template<typename T>
+        using Row = Eigen::Array<T, 1, Eigen::Dynamic>;
+    //----
+    template<typename T>
+    void distortT(const CamCfg::Dist& D, Row<T>& x, Row<T>& y)
+    {
+        T k1=D.k1, k2=D.k2, k3=D.k3, p1=D.p1, p2=D.p2;
+        Row<T> r2 = x*x + y*y;
+        Row<T> a  = 1 + r2*(k1 + r2*(k2 + r2*k3));
+        Row<T> xy = x*y;
+        Row<T> xd = x*a + 2*p1*xy + p2*(r2 + 2*x*x);
+        y = y*a + p1*(r2 + 2*y*y) + 2*p2*xy;
+        x = xd;
+    }
+    //----
+    template<typename T, typename V3, typename V2>
+    void projT(const CamCfg& cc, const vector<V3>& Ps,
+               vector<V2>& vs, bool bDist)
+    {
+        using namespace Eigen;
+        int N = Ps.size();
+        vs.resize(N);
+        if(N==0) return;
+        Map<const Array<T,3,Dynamic>> P(Ps[0].data(), 3, N);
+        Map<Array<T,2,Dynamic>> v(vs[0].data(), 2, N);
+        auto& K = cc.K;
+        T fx=K(0,0), fy=K(1,1), cx=K(0,2), cy=K(1,2);
+        Row<T> z = P.row(2);
+        Row<T> iz = (z!=0).select(z.inverse(), 0);
+        Row<T> x = P.row(0)*iz;
+        Row<T> y = P.row(1)*iz;
+        if(bDist) distortT<T>(cc.D, x, y);
+        v.row(0) = (z!=0).select(fx*x + cx, 0);
+        v.row(1) = (z!=0).select(fy*y + cy, 0);
+    }
+    //----
+    template<typename T, typename V2, typename V3>
+    void backProjT(const CamCfg& cc, const vector<V2>& vs,
+                   vector<V3>& Ps)
+    {
+        using namespace Eigen;
+        int N = vs.size();
+        Ps.resize(N);
+        if(N==0) return;
+        Map<const Array<T,2,Dynamic>> v(vs[0].data(), 2, N);
+        Map<Array<T,3,Dynamic>> P(Ps[0].data(), 3, N);
+        auto& K = cc.K;
+        T fx=K(0,0), fy=K(1,1), cx=K(0,2), cy=K(1,2);
+        P.row(0) = (v.row(0) - cx) / fx;
+        P.row(1) = (v.row(1) - cy) / fy;
+        P.row(2).setOnes();
+    }
+    //----
+    template<typename T, typename V2>
+    void distortV(const CamCfg& cc, vector<V2>& ns)
+    {
+        using namespace Eigen;
+        int N = ns.size();
+        if(N==0) return;
+        Map<Array<T,2,Dynamic>> n(ns[0].data(), 2, N);
+        Row<T> x = n.row(0), y = n.row(1);
+        distortT<T>(cc.D, x, y);
+        n.row(0) = x;
+        n.row(1) = y;
+    }
+}
+//----
+void CamCfg::proj(const vec3s& Ps, vec2s& vs, bool bDist)const
+{ projT<double>(*this, Ps, vs, bDist); }
+void CamCfg::proj(const vec3fs& Ps, vec2fs& vs, bool bDist)const
+{ projT<float>(*this, Ps, vs, bDist); }
+void CamCfg::backProj(const vec2s& vs, vec3s& Ps)const
+{ backProjT<double>(*this, vs, Ps); }
+void CamCfg::backProj(const vec2fs& vs, vec3fs& Ps)const
+{ backProjT<float>(*this, vs, Ps); }
+void CamCfg::distort(vec2s& ns)const
+{ distortV<double>(*this, ns); }
+void CamCfg::distort(vec2fs& ns)const
+{ distortV<float>(*this, ns); }
+//---- end points in one batch
+void CamCfg::proj(const vector<Line>& ls, vector<Line2d>& l2s,
+                  bool bDist)const
+{
+    vec3s Ps;
+    Ps.reserve(ls.size()*2);
+    for(auto& l : ls)
+    {   Ps.push_back(l.p1); Ps.push_back(l.p2); }
+    vec2s vs;
+    proj(Ps, vs, bDist);
+    l2s.clear();
+    for(size_t i=0;i<ls.size();i++)
+        l2s.push_back(Line2d(vs[2*i], vs[2*i+1]));
+}
+
+//----------
+// undistortion lookup
+//----------
+struct CamCfg::Lut{
+    //---- built for
+    mat3 K;
+    vec5 D;
+    Sz sz;
+    int step = 0;
+    cv::Mat Kc, Dc;
+    //---- normalized undistorted coords per
+    //   grid node, row major.
+    int nx=0, ny=0;
+    vec2s ns;
+    bool match(const CamCfg& c)const
+    {   return K==c.K && D==c.D.V() && step==c.lut_step &&
+               sz.w==c.sz.w && sz.h==c.sz.h; }
+    bool at(const vec2& v, vec2& n)const
+    {
+        if(ns.empty() || !v.allFinite()) return false;
+        double gx = v.x()/step, gy = v.y()/step;
+        int ix = std::floor(gx), iy = std::floor(gy);
+        if(ix<0 || iy<0 || ix>=nx-1 || iy>=ny-1)
+            return false;
+        double tx = gx-ix, ty = gy-iy;
+        int i = iy*nx + ix;
+        n = (ns[i]*(1-tx)    + ns[i+1]*tx)*(1-ty) +
+            (ns[i+nx]*(1-tx) + ns[i+nx+1]*tx)*ty;
+        return true;
+    }
+};
+//---- grid nodes through the solver once
+Sp<CamCfg::Lut> CamCfg::lut()const
+{
+    auto p = std::atomic_load(&p_lut_);
+    if(p!=nullptr && p->match(*this))
+        return p;
+    p = mkSp<Lut>();
+    auto& L = *p;
+    L.K = K; L.D = D.V(); L.sz = sz;
+    L.step = lut_step;
+    eigen2cv(K, L.Kc);
+    eigen2cv(D.V(), L.Dc);
+    if(lut_step>0 && sz.w>1 && sz.h>1)
+    {
+        int st = lut_step;
+        L.nx = (sz.w-1 + st-1)/st + 1;
+        L.ny = (sz.h-1 + st-1)/st + 1;
+        vector<Point2f> ps, cs;
+        for(int y=0;y<L.ny;y++)
+            for(int x=0;x<L.nx;x++)
+                ps.push_back(Point2f(x*st, y*st));
+        cv::undistortPoints(ps, cs, L.Kc, L.Dc);
+        for(auto& c : cs)
+            L.ns.push_back(toVec(c));
+    }
+    std::atomic_store(&p_lut_, p);
+    return p;
+}
+
 //-----
 // ref : https://blog.csdn.net/jonathanzh/article/details/104418758
 void CamCfg::undis(const vec2s& vds, vec2s& vs)const
 {
-    vector<Point2f> cds;
-    vector<Point2f> cs;
-    stringstream s;
- //   s << "vds:" << endl;
-    for(auto& v : vds)
-    {
-    //    s << v << endl; 
-        cds.push_back(toCv(v));
-    }
-    cv::Mat Kc,Dc; 
-    eigen2cv(K, Kc);
-    eigen2cv(D.V(), Dc);
-    cv::undistortPoints(cds, cs, Kc, Dc);
- //   s << "vs:" << endl;
-    for(auto& c : cs) 
+    auto p = lut();
+    auto& L = *p;
+    size_t i0 = vs.size();
+    vs.resize(i0 + vds.size());
+    auto reproj = [&](const vec2& u, vec2& v)
     {
-        vec2 u = toVec(c);
         vec3 vn; vn << u.x(), u.y(), 1;
         vec3 q = K*vn;
-        vec2 v; v << q.x(), q.y(); 
-    //    s << v << endl;
-        vs.push_back(v);
+        v << q.x(), q.y();
+    };
+    //---- lookup, off grid to solver
+    vector<int> ids;
+    for(size_t i=0;i<vds.size();i++)
+    {
+        vec2 n;
+        if(L.at(vds[i], n)) reproj(n, vs[i0+i]);
+        else ids.push_back(i);
     }
-  //  log_d(s.str());
+    if(ids.empty()) return;
+    vector<Point2f> cds, cs;
+    for(auto i : ids)
+        cds.push_back(toCv(vds[i]));
+    cv::undistortPoints(cds, cs, L.Kc, L.Dc);
+    for(size_t k=0;k<ids.size();k++)
+        reproj(toVec(cs[k]), vs[i0+ids[k]]);
 }
 
 //----------
@@ -0,0 +1,349 @@
+#include "vsn/vsnLibCv.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace vsn;
+using namespace ocv;
+using namespace ut;
+
+namespace{
+    struct LCfg{
+        // frame alignment in file
+        size_t page = 4096;
+        int log_N = 100; // convert progress
+    }; LCfg lc_;
+    //---- file header, first page of file
+    const char sMagic_[8]{'V','S','N','F','R','M',0,1};
+    struct Hdr{
+        char magic[8]{};
+        uint32_t ver = 1;
+        uint32_t N = 0;      // entries
+        uint32_t N_side = 1;
+        int32_t w=0, h=0, chn=0, depth=0;
+        int32_t clrSpc = 0;
+        uint64_t step = 0;   // bytes per row
+        uint64_t frmBytes=0; // per side, unpadded
+        uint64_t idxOfs = 0;
+    };
+    //---- index entry : int64 file idx,
+    //   then N_side uint64 offsets.
+    size_t align(size_t n)
+    { return (n + lc_.page-1) / lc_.page * lc_.page; }
+    //---- read only mapping of the whole file,
+    //   header, index and prefetch hints.
+    struct Map{
+        uint8_t* p = nullptr;
+        size_t len = 0;
+        ~Map(){ if(p!=nullptr) munmap(p, len); }
+    };
+
+    //------------
+    // FrmPackCv
+    //------------
+    class FrmPackCv : public FrmPack{
+    public:
+        bool init(CStr& sf);
+        virtual Sp<Img> read()override
+        {   Sp<Img> pL, pR;
+            readLR(pL, pR); return pL; }
+        virtual bool readLR(Sp<Img>& pL, Sp<Img>& pR)override;
+        virtual int size()const override{ return hdr_.N; }
+        virtual int N_side()const override{ return hdr_.N_side; }
+        virtual bool seek(int64_t i)override;
+        virtual int64_t N_frms()const override{ return hdr_.N; }
+        virtual int frmIdx()const override{ return frmIdx_; }
+        virtual void close()override{ p_map_ = nullptr; }
+    protected:
+        Hdr hdr_;
+        string sf_;
+        Sp<Map> p_map_ = nullptr;
+        const uint8_t* p_idx_ = nullptr;
+        int i_ = 0;
+        int frmIdx_ = -1;
+        size_t entSz()const
+        { return sizeof(int64_t) + hdr_.N_side*sizeof(uint64_t); }
+        uint64_t frmOfs(int i, int k)const
+        {   uint64_t o;
+            memcpy(&o, p_idx_ + i*entSz() + sizeof(int64_t)
+                   + k*sizeof(uint64_t), sizeof(o));
+            return o; }
+        Sp<Img> frm(int i, int k);
+        void prefetch(int i);
+    };
+    //----
+    bool FrmPackCv::init(CStr& sf)
+    {
+        int fd = ::open(sf.c_str(), O_RDONLY);
+        if(fd<0)
+        {
+            log_ef(sf);
+            return false;
+        }
+        struct stat st;
+        bool ok = fstat(fd, &st)==0 &&
+                  size_t(st.st_size) >= sizeof(Hdr);
+        auto p_map = mkSp<Map>();
+        if(ok)
+        {
+            p_map->len = st.st_size;
+            void* pm = mmap(nullptr, p_map->len, PROT_READ,
+                            MAP_SHARED, fd, 0);
+            if(pm==MAP_FAILED) ok = false;
+            else p_map->p = (uint8_t*)pm;
+        }
+        ::close(fd);
+        if(!ok)
+        {
+            log_e("FrmPack: failed to map '"+sf+"'");
+            return false;
+        }
+        //---- header, then index bounds, all
+        //   checked before p_idx_ is set. 
+        //   Compared as len - ofs, no overflow.
+        memcpy(&hdr_, p_map->p, sizeof(Hdr));
+        auto& h = hdr_;
+        size_t len = p_map->len;
+        int type = CV_MAKETYPE(h.depth, h.chn);
+        ok = memcmp(h.magic, sMagic_, sizeof(sMagic_))==0 &&
+             (h.N_side==1 || h.N_side==2) &&
+             h.w>0 && h.h>0 && h.chn>0 && h.chn<=CV_CN_MAX &&
+             h.depth>=0 && h.depth<=CV_64F &&
+             h.step >= size_t(h.w)*CV_ELEM_SIZE(type) &&
+             h.frmBytes == h.step*h.h &&
+             h.idxOfs <= len &&
+             h.N <= (len - h.idxOfs) / entSz();
+        if(!ok)
+        {
+            log_e("FrmPack: invalid file '"+sf+"'");
+            return false;
+        }
+        p_idx_ = p_map->p + h.idxOfs;
+        for(int i=0;i<h.N;i++)
+            for(int k=0;k<h.N_side;k++)
+            {
+                uint64_t o = frmOfs(i, k);
+                if(o > len || h.frmBytes > len - o)
+                {
+                    log_e("FrmPack: truncated file '"+sf+"'");
+                    p_idx_ = nullptr;
+                    return false;
+                }
+            }
+        p_map_ = p_map;
+        sf_ = sf;
+        madvise(p_map->p, p_map->len, MADV_SEQUENTIAL);
+        Video::cfg_.sz = {h.w, h.h};
+        //----
+        stringstream s;
+        s << "FrmPack open:'" << sf << "', frames:" << h.N
+          << ", sides:" << h.N_side
+          << ", size:" << h.w << "x" << h.h;
+        log_i(s.str());
+        prefetch(0);
+        return true;
+    }
+    //---- zero-copy Img, own private mapping 
+    //   of the frame pages: in place ops are 
+    //   copy-on-write for this Img only, the
+    //   file and other readers never see them.
+    Sp<Img> FrmPackCv::frm(int i, int k)
+    {
+        auto& h = hdr_;
+        Img::Buf b;
+        b.w = h.w; b.h = h.h;
+        b.step = h.step;
+        b.chn = h.chn;
+        b.depth = (PxDepth)h.depth;
+        auto p = Img::mapFile(sf_, b, frmOfs(i, k), false);
+        if(p!=nullptr)
+            p->setClrSpc((Img::ClrSpc)h.clrSpc);
+        return p;
+    }
+    //---- hint kernel to read next entry
+    void FrmPackCv::prefetch(int i)
+    {
+        if(i >= (int)hdr_.N) return;
+        for(int k=0;k<hdr_.N_side;k++)
+            madvise(p_map_->p + frmOfs(i, k),
+                    hdr_.frmBytes, MADV_WILLNEED);
+    }
+    //----
+    bool FrmPackCv::readLR(Sp<Img>& pL, Sp<Img>& pR)
+    {
+        pL = pR = nullptr;
+        if(p_map_==nullptr || i_ >= (int)hdr_.N)
+            return false;
+        int i = i_;
+        i_ += std::max(Video::cfg_.rd.stride, 1);
+        prefetch(i_);
+        pL = frm(i, 0);
+        if(hdr_.N_side>1)
+            pR = frm(i, 1);
+        int64_t fi;
+        memcpy(&fi, p_idx_ + i*entSz(), sizeof(fi));
+        frmIdx_ = fi;
+        for(auto p : {pL, pR})
+            if(p!=nullptr)
+            {   p->frm.seq = i; p->frm.idx = fi; }
+        return pL!=nullptr;
+    }
+    //----
+    bool FrmPackCv::seek(int64_t i)
+    {
+        if(i<0 || i>=(int64_t)hdr_.N)
+        {
+            log_e("FrmPack: seek out of range:"+to_string(i));
+            return false;
+        }
+        i_ = i;
+        prefetch(i_);
+        return true;
+    }
+}
+
+//----
+Sp<FrmPack> FrmPack::open(CStr& sf)
+{
+    auto p = mkSp<FrmPackCv>();
+    if(!p->init(sf))
+        return nullptr;
+    return p;
+}
+
+//------------
+// Writer
+//------------
+bool FrmPack::Writer::open(CStr& sf, int N_side)
+{
+    close();
+    if(N_side!=1 && N_side!=2)
+    {
+        log_e("FrmPack: N_side must be 1 or 2");
+        return false;
+    }
+    ofs_.open(sf, std::ios::binary | std::ios::trunc);
+    if(!ofs_.is_open())
+    {
+        log_ef(sf);
+        return false;
+    }
+    sf_ = sf;
+    N_side_ = N_side;
+    lay_ = Img::CBuf();
+    ofss_.clear();
+    idxs_.clear();
+    //---- header page, patched on close()
+    string sp(lc_.page, '\0');
+    ofs_.write(sp.data(), sp.size());
+    return true;
+}
+//---- rows packed, frame padded to page
+bool FrmPack::Writer::addImg(const Img& im)
+{
+    auto b = im.buf();
+    size_t rowSz = size_t(b.w) * 
+        CV_ELEM_SIZE(CV_MAKETYPE((int)b.depth, b.chn));
+    if(lay_.w==0)
+    {
+        lay_ = b;
+        lay_.p = nullptr;
+        lay_.step = rowSz;
+    }
+    else if(b.w!=lay_.w || b.h!=lay_.h ||
+            b.chn!=lay_.chn || b.depth!=lay_.depth)
+    {
+        log_e("FrmPack: img layout differs from first frame");
+        return false;
+    }
+    ofss_.push_back(ofs_.tellp());
+    for(int y=0;y<b.h;y++)
+        ofs_.write((const char*)b.p + y*b.step, rowSz);
+    size_t n = rowSz*b.h;
+    string sp(align(n) - n, '\0');
+    ofs_.write(sp.data(), sp.size());
+    return ofs_.good();
+}
+//----
+bool FrmPack::Writer::add(const Img& im, const Img* p_imR, int idx)
+{
+    if(!ofs_.is_open()) return false;
+    if((p_imR!=nullptr) != (N_side_==2))
+    {
+        log_e("FrmPack: right img must match N_side");
+        return false;
+    }
+    if(ofss_.empty()) clrSpc_ = (int)im.clrSpc();
+    //---- entry is all sides or nothing, 
+    //   rolled back on failure.
+    auto pos = ofs_.tellp();
+    size_t n0 = ofss_.size();
+    bool ok = addImg(im) && 
+              (p_imR==nullptr || addImg(*p_imR));
+    if(!ok)
+    {
+        ofss_.resize(n0);
+        ofs_.clear();
+        ofs_.seekp(pos);
+        return false;
+    }
+    idxs_.push_back(idx<0 ? (int)idxs_.size() : idx);
+    return true;
+}
+//----
+bool FrmPack::Writer::close()
+{
+    if(!ofs_.is_open()) return true;
+    Hdr h;
+    memcpy(h.magic, sMagic_, sizeof(sMagic_));
+    h.N = idxs_.size();
+    h.N_side = N_side_;
+    h.w = lay_.w; h.h = lay_.h;
+    h.chn = lay_.chn;
+    h.depth = (int)lay_.depth;
+    h.clrSpc = clrSpc_;
+    h.step = lay_.step;
+    h.frmBytes = lay_.step * lay_.h;
+    h.idxOfs = ofs_.tellp();
+    //---- index
+    for(int i=0;i<h.N;i++)
+    {
+        int64_t fi = idxs_[i];
+        ofs_.write((const char*)&fi, sizeof(fi));
+        for(int k=0;k<N_side_;k++)
+        {
+            uint64_t o = ofss_[i*N_side_ + k];
+            ofs_.write((const char*)&o, sizeof(o));
+        }
+    }
+    ofs_.seekp(0);
+    ofs_.write((const char*)&h, sizeof(h));
+    bool ok = ofs_.good();
+    ofs_.close();
+    if(ok)
+        log_i("FrmPack write:'"+sf_+"', frames:"+to_string(h.N));
+    else
+        log_ef(sf_);
+    return ok;
+}
+
+//----
+bool FrmPack::convert(ImgSeq& seq, CStr& sfw, bool bLR)
+{
+    Writer w;
+    if(!w.open(sfw, bLR ? 2 : 1))
+        return false;
+    Sp<Img> pL, pR;
+    int n = 0;
+    while(seq.readLR(pL, pR))
+    {
+        if(!w.add(*pL, bLR ? pR.get() : nullptr,
+                  seq.frmIdx()))
+            return false;
+        if(++n % lc_.log_N == 0)
+            log_i("  packed frames:"+to_string(n)+
+                  "/"+to_string(seq.size()));
+    }
+    return w.close();
+}
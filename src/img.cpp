@@ -42,12 +42,21 @@ Sp<Img> Img::create()
 {
     return make_shared<ocv::ImgCv>();
 }
+//----
+Sp<Img> Img::create(const Sz& sz, int chn, PxDepth d)
+{
+    auto p = mkSp<ocv::ImgCv>();
+    auto& im = p->im_;
+    im.allocator = poolAlloc();
+    im.create(sz.h, sz.w, CV_MAKETYPE((int)d, chn));
+    return p;
+}
 
 //-----
 Sp<Img> Img::loadFile(const string& sf, int cvFlags)
 {
     auto p = Img::create();
-    if(p->load(sf))
+    if(p->load(sf, cvFlags))
       return p;
     return nullptr;
 
@@ -63,20 +72,21 @@ void Img::draw(const CamCfg& cc, const Axis& a)
     
     auto ls = pose2axis(p, l);
     Color rgb[3]{{255,0,0}, {0,255,0}, {0,0,255}};
-    int i=0;
+    // undistorted img assumed, as proj(Line)
+    vector<Line2d> l2s;
+    cc.proj(ls, l2s, false);
     for(int i=0;i<3;i++)
-    {
-        Line2d l = cc.proj(ls[i]);
-        draw({l}, rgb[i], w);
-    }
+        draw({l2s[i]}, rgb[i], w);
 }
 //----
 void Img::draw(const CamCfg& cc, const vector<Line>& lns, const Color& c, float w)
 {
-    for(auto& l : lns)
-        draw({cc.proj(l)}, c, w);
+    vector<Line2d> l2s;
+    cc.proj(lns, l2s, false);
+    draw(l2s, c, w);
 }
 
+
 //-----
 /* TODO: replaced by draw lines
 void Img::draw(const CamCfg& cc, const Cylinder& cl, const Color& c, float w)
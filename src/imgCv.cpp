@@ -14,17 +14,131 @@ using namespace ocv;
 using namespace vsn;
 
 namespace{
-            
-
+    struct LCfg{
+        // max cached rotation maps
+        int N_rotMaps = 8;
+        // angle snap to 90 multiples (degree)
+        double rot_eps = 1e-6;
+    }; LCfg lc_;
+    //------------
+    // rotation map cache, keyed by (w, h, angle)
+    //------------
+    struct RotMaps{
+        struct Key{ 
+            int w=0, h=0; double dgr=0; 
+            bool operator < (const Key& k)const
+            { return std::tie(w, h, dgr) < 
+                     std::tie(k.w, k.h, k.dgr); }
+        };
+        struct Maps{ cv::Mat m1, m2; };
+        //---- same transform as warpAffine() with
+        //   getRotationMatrix2D(), fixed point maps.
+        Maps get(const cv::Size& sz, double dgr)
+        {
+            Key k{sz.width, sz.height, dgr};
+            std::unique_lock<std::mutex> lk(mtx_);
+            auto it = maps_.find(k);
+            if(it!=maps_.end()) return it->second;
+            lk.unlock();
+            //----
+            cv::Point2f c((sz.width-1)/2.0, (sz.height-1)/2.0);
+            cv::Mat R = cv::getRotationMatrix2D(c, dgr, 1.0);
+            cv::Mat Ri;
+            cv::invertAffineTransform(R, Ri);
+            cv::Matx23d A((double*)Ri.data);
+            cv::Mat m(sz, CV_32FC2);
+            for(int y=0;y<sz.height;y++)
+            {
+                auto pm = m.ptr<cv::Vec2f>(y);
+                for(int x=0;x<sz.width;x++)
+                    pm[x] = cv::Vec2f(
+                        A(0,0)*x + A(0,1)*y + A(0,2),
+                        A(1,0)*x + A(1,1)*y + A(1,2));
+            }
+            Maps ms;
+            cv::convertMaps(m, cv::noArray(), ms.m1, ms.m2, 
+                            CV_16SC2);
+            //----
+            lk.lock();
+            if((int)maps_.size() >= lc_.N_rotMaps)
+                maps_.clear();
+            maps_[k] = ms;
+            return ms;
+        }
+    protected:
+        std::mutex mtx_;
+        map<Key, Maps> maps_;
+    }; RotMaps rotMaps_;
+    //---- quarter turns of dgr, -1 if not a
+    //   multiple of 90.
+    int quarter(double dgr)
+    {
+        double a = std::fmod(dgr, 360.0);
+        if(a < 0) a += 360.0;
+        double q = std::round(a/90.0);
+        if(std::abs(a - q*90.0) > lc_.rot_eps) 
+            return -1;
+        return int(q) % 4;
+    }
 }
 //---------
+// Same result as warpAffine() about the centre, 
+//   output keeps the size. 180 flips (in place
+//   if im_ owns its pixels alone),
+//   90/270 are exact when w-h is even (rotated
+//   img lands on whole pixels), other angles 
+//   remap with cached maps into a pooled buffer.
 void ImgCv::rot(double dgr)
 {
-    cv::Point2f center((im_.cols - 1)/2.0, (im_.rows - 1)/2.0);
-    cv::Mat R = cv::getRotationMatrix2D( center,dgr , 1.0 );
+    if(im_.empty()) return;
+    int q = quarter(dgr);
+    int W = im_.cols, H = im_.rows;
+    if(q==0) return;
     cv::Mat imr;
-    cv::warpAffine(im_, imr, R, im_.size());
+    imr.allocator = poolAlloc();
+    if(q==2)
+    {
+        //---- in place only if no view, wrapper
+        //   or cache shares the pixels.
+        bool bOwn = (im_.u!=nullptr && im_.u->refcount==1);
+        if(bOwn)
+        {
+            cv::flip(im_, im_, -1);
+            touch();
+            return;
+        }
+        cv::flip(im_, imr, -1);
+        im_ = imr;
+        touch();
+        chkRealloc("rot");
+        return;
+    }
+    if(q>0 && (W-H)%2==0)
+    {
+        //---- rotate into HxW, then centre it on 
+        //   a zeroed WxH canvas, clipped.
+        cv::Mat imt;
+        cv::rotate(im_, imt, (q==1) ? 
+            cv::ROTATE_90_COUNTERCLOCKWISE : 
+            cv::ROTATE_90_CLOCKWISE);
+        imr.create(im_.size(), im_.type());
+        imr = cv::Scalar::all(0);
+        int dx = (W-H)/2;
+        int dy = (H-W)/2;
+        cv::Rect rt(0, 0, imt.cols, imt.rows);
+        cv::Rect rd = (rt + cv::Point(dx, dy)) & 
+                      cv::Rect(0, 0, W, H);
+        imt(rd - cv::Point(dx, dy)).copyTo(imr(rd));
+    }
+    else
+    {
+        auto ms = rotMaps_.get(im_.size(), dgr);
+        cv::remap(im_, imr, ms.m1, ms.m2, 
+                  cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    }
     im_ = imr;
+    touch();
+    chkRealloc("rot");
 }
 
 //---------
@@ -37,6 +151,8 @@ void ImgCv::undistort(const CamCfg& cc)
     Mat imd;
     cv::undistort(im_, imd, Kc, Dc);
     im_ = imd;
+    touch();
+    chkRealloc("undistort");
 }
 
 
@@ -44,6 +160,10 @@ void ImgCv::undistort(const CamCfg& cc)
 bool ImgCv::load(ut::CStr& s, int cvFlag)
 {
     im_ = cv::imread(s, cvFlag);
+    touch();
+    cs_ = (cvFlag==cv::IMREAD_GRAYSCALE) ? ClrSpc::GRAY :
+          (cvFlag==cv::IMREAD_COLOR) ? ClrSpc::BGR :
+                                       ClrSpc::UNKNOWN;
     bool ok = val();
     if(ok)
         log_i("Img load:"+s);
@@ -79,6 +199,7 @@ void ImgCv::draw(CStr& s,
     cv::Scalar c1 = toCv(c);
     cv::putText(im_,s,{px.x,px.y},cv::FONT_HERSHEY_DUPLEX,
         font_scl ,c1, 2, false);
+    touch();
 }
 
 //------
@@ -98,6 +219,7 @@ void ImgCv::draw(const vector<Line2d>& lns, const Color& c, double w)
         Point p2(l.p2.x(), l.p2.y());
         cv::line(im_, p1, p2, toCv(c), w);
     }
+    touch();
 }
 
 //--------
@@ -111,6 +233,7 @@ void ImgCv::draw(const ut::Rect& r,
         Point(p0.x, p0.y), 
         Point(p1.x, p1.y), 
         toCv(c), w);
+    touch();
 }
 //--------
 void ImgCv::draw(const vector<Circle>& cs, const Color& c, float w)
@@ -120,33 +243,141 @@ void ImgCv::draw(const vector<Circle>& cs, const Color& c, float w)
         Point2f cn(o.c.x(), o.c.y()) ;
         cv::circle(im_, cn, o.r, toCv(c), w);
     }
+    touch();
 }
 
+//--------
+// cvt() drops entries of older versions, 
+//   so a write only bumps the version.
+void ImgCv::touch()
+{
+    (*p_ver_)++;
+}
+//---- switch im_ to colour space c, the old
+//   pixels stay cached so converting back 
+//   is a hit. im_ gets its own buffer, a 
+//   view from as(c) stays read only.
+void ImgCv::setCvt(ClrSpc c)
+{
+    ClrSpc c0 = clrSpcEff();
+    cv::Mat im0 = im_;
+    cv::Mat im = cvt(c);
+    {
+        std::lock_guard<std::mutex> lk(cache_.mtx);
+        cache_.m.erase(c);
+    }
+    if(im.u!=nullptr && im.u->refcount > 1)
+    {
+        cv::Mat imc;
+        imc.allocator = poolAlloc();
+        im.copyTo(imc);
+        im = imc;
+    }
+    im_ = im;
+    cs_ = c;
+    touch();
+    std::lock_guard<std::mutex> lk(cache_.mtx);
+    cache_.m[c0] = {ver(), im0};
+}
 //--------
 void ImgCv::toGray()
 {
-    cv::cvtColor(im_, im_,cv::COLOR_BGR2GRAY);
+    if(clrSpcEff()==ClrSpc::GRAY) return;
+    setCvt(ClrSpc::GRAY);
+    chkRealloc("toGray");
 }
 //--------
 void ImgCv::toHsv()
 {
-    cv::cvtColor(im_, im_,cv::COLOR_BGR2HSV);
+    if(clrSpcEff()==ClrSpc::HSV) return;
+    setCvt(ClrSpc::HSV);
+    chkRealloc("toHsv");
+}
+//--------
+Img::ClrSpc ImgCv::clrSpcEff()const
+{
+    if(cs_!=ClrSpc::UNKNOWN) return cs_;
+    int n = im_.channels();
+    return (n==1) ? ClrSpc::GRAY :
+           (n==3) ? ClrSpc::BGR : ClrSpc::UNKNOWN;
+}
+//--------
+cv::Mat ImgCv::cvt(ClrSpc c)const
+{
+    ClrSpc c0 = clrSpcEff();
+    if(c==c0 || im_.empty()) return im_;
+    uint32_t v = ver();
+    {
+        std::lock_guard<std::mutex> lk(cache_.mtx);
+        auto& m = cache_.m;
+        auto it = m.find(c);
+        if(it!=m.end() && it->second.ver==v)
+            return it->second.im;
+        //---- keep current pixels too, so converting
+        //   back (e.g. BGR->HSV->BGR) is a cache hit.
+        m[c0] = {v, im_};
+    }
+    //---- convert unlocked, may recurse via BGR
+    //---- direct code, or through BGR
+    int code = -1;
+    using C = ClrSpc;
+    if(c0==C::BGR && c==C::GRAY) code = cv::COLOR_BGR2GRAY;
+    if(c0==C::BGR && c==C::HSV)  code = cv::COLOR_BGR2HSV;
+    if(c0==C::GRAY && c==C::BGR) code = cv::COLOR_GRAY2BGR;
+    if(c0==C::HSV && c==C::BGR)  code = cv::COLOR_HSV2BGR;
+    cv::Mat im;
+    im.allocator = poolAlloc();
+    if(code>=0)
+        cv::cvtColor(im_, im, code);
+    else if(c0!=C::UNKNOWN && c!=C::UNKNOWN && c!=C::BGR)
+    {
+        cv::Mat imb = cvt(C::BGR);
+        cv::cvtColor(imb, im, (c==C::GRAY) ? 
+            cv::COLOR_BGR2GRAY : cv::COLOR_BGR2HSV);
+    }
+    else
+    {
+        log_e("Img: no conversion to color space "+
+              to_string((int)c));
+        return im_;
+    }
+    std::lock_guard<std::mutex> lk(cache_.mtx);
+    auto& m = cache_.m;
+    for(auto it=m.begin(); it!=m.end();)
+        if(it->second.ver!=v) it = m.erase(it);
+        else ++it;
+    m[c] = {v, im};
+    return im;
+}
+//--------
+Sp<const Img> ImgCv::as(ClrSpc c)const
+{
+    auto p = mkSp<ImgCv>();
+    p->im_ = cvt(c);
+    p->cs_ = (p->im_.data==im_.data) ? cs_ : c;
+    return p;
 }
 //--------
 void ImgCv::blur(int w)
 {
     cv::blur(im_, im_, Size(w, w)); 
-    
+    touch();
+    chkRealloc("blur");
 }
 //--------
 void ImgCv::filter(const HSV& c0,
                    const HSV& c1)
 {
     cv::inRange(im_, toCv(c0), toCv(c1), im_);
+    touch();
+    cs_ = ClrSpc::UNKNOWN; // mask
+    chkRealloc("filter");
 }
 void ImgCv::scale(const Sz& sz, int method)
 {
     cv::resize(im_, im_, cv::Size(sz.w, sz.h), method);
+    touch();
+    chkRealloc("scale");
 }
 
 //-----
@@ -171,19 +402,27 @@ Sp<Img> ImgCv::crop(const ut::Rect& r)const
     Range rrow(r0, r1);
     Range rcol(c0, c1);
     Mat imc = im_(rrow, rcol);
-    return mkSp<ImgCv>(imc);
+    auto p = mkSp<ImgCv>(imc);
+    p->cs_ = cs_;
+    p->p_ver_ = p_ver_;
+    if(isExt())
+        p->setExt(onRealloc_);
+    return p;
 }
 
 
 //-----
 vector<Line2d> ImgCv::det(const HoughLnCfg& c)const
 {
-    // TODO: detect already gray scale
-    cv::Mat im = im_;
-    if(im.channels()==3)
-        cv::cvtColor(im_, im,cv::COLOR_BGR2GRAY);
+    // gray is shared with cache or im_, 
+    //   Canny into a new Mat.
+    cv::Mat im = cvt(ClrSpc::GRAY);
     if(c.doCanny)
-        cv::Canny(im, im, 50, 200, 3); // TODO: cfg
+    {
+        cv::Mat ime;
+        cv::Canny(im, ime, 50, 200, 3); // TODO: cfg
+        im = ime;
+    }
     vector<Vec4i> lines;
     cv::HoughLinesP( im, lines, c.rho, c.theta, c.TH, 
                         c.minLnLen, c.maxLnGap );
@@ -219,11 +458,58 @@ vector<Circle> ImgCv::det(const HoughCirCfg& c)const
     return cirs;
 }
 
+//-----
+namespace{
+    template<typename B>
+    B mat2buf(const cv::Mat& m)
+    {
+        B b;
+        b.p = m.data;
+        b.w = m.cols;
+        b.h = m.rows;
+        b.step = m.step[0];
+        b.chn = m.channels();
+        b.depth = (PxDepth)m.depth();
+        return b;
+    }
+}
+Img::Buf ImgCv::buf()
+{ return mat2buf<Buf>(im_); }
+Img::CBuf ImgCv::buf()const
+{ return mat2buf<CBuf>(im_); }
+
+//-----
+ImgCv::ImgCv(const Img& im)
+{
+    auto p = dynamic_cast<const ImgCv*>(&im);
+    cs_ = im.clrSpc();
+    if(p!=nullptr)
+    {   im_ = p->im_; p_ver_ = p->p_ver_; return; }
+    //---- other impl, borrow its pixels,
+    //   shared like a Mat copy.
+    auto b = im.buf();
+    if(b.p==nullptr) return;
+    im_ = cv::Mat(b.h, b.w, 
+        CV_MAKETYPE((int)b.depth, b.chn), 
+        const_cast<uint8_t*>(b.p), b.step);
+}
+//---- after an op, notify once if im_ left
+//   the wrapped buffer (see Img::Ext).
+void ImgCv::chkRealloc(CStr& sOp)
+{
+    if(p_extU_==nullptr || im_.u==p_extU_) 
+        return;
+    p_extU_ = nullptr;
+    if(onRealloc_!=nullptr)
+        onRealloc_(sOp);
+}
+
 //----- set/get
 void ImgCv::set(const Px& px, const Color& c) 
 {
     if(!size().isIn(px)) return;
     im_.ptr<BGR>(px.y)[px.x] = BGR(c);
+    touch();
 }
 bool ImgCv::get(const Px& px, Color& c)const
 {
@@ -237,6 +523,7 @@ void ImgCv::set(const Px& px, const HSV& c)
 {
     if(!size().isIn(px)) return;
     im_.ptr<HSV>(px.y)[px.x] = HSV(c);
+    touch();
 }
 bool ImgCv::get(const Px& px, HSV& c)const
 {
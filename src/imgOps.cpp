@@ -0,0 +1,343 @@
+#include "vsn/vsnLibCv.h"
+
+using namespace vsn;
+using namespace ocv;
+using namespace ut;
+
+namespace{
+    struct LCfg{
+        int band_rows = 32;
+        // map border value, lands outside any img
+        float map_out = -1e5;
+    }; LCfg lc_;
+    //----
+    // op type : 0 scale, 1 rot, 2 undistort,
+    //   10 toGray, 11 toHsv, 12 filter, 13 blur
+    struct Op{
+        int type = 0;
+        cv::Size sz;
+        int method = 1;
+        double dgr = 0;
+        cv::Mat Kc, Dc;
+        cv::Scalar c0, c1;
+        int w = 0;
+        // toGray/toHsv cvtColor codes from the 
+        //   input colour space, set per run(),
+        //   empty : already there, no-op.
+        vector<int> codes;
+        bool isGeo()const{ return type < 10; }
+        bool isNop()const
+        { return (type==10 || type==11) && codes.empty(); }
+    };
+    //---- per-op map, output coords to input
+    //   coords (CV_32FC2), szo output size.
+    cv::Mat geo_map(const Op& o, const cv::Size& szi,
+                    cv::Size& szo)
+    {
+        cv::Mat m;
+        if(o.type==2)
+        {
+            szo = szi;
+            cv::initUndistortRectifyMap(o.Kc, o.Dc, cv::Mat(),
+                o.Kc, szo, CV_32FC2, m, cv::noArray());
+            return m;
+        }
+        //---- scale and rot are affine, out to in
+        cv::Matx23d A(1,0,0, 0,1,0);
+        if(o.type==0)
+        {
+            // same pixel centre rule as cv::resize
+            szo = o.sz;
+            double sx = double(szi.width) /szo.width;
+            double sy = double(szi.height)/szo.height;
+            A = cv::Matx23d(sx,0,0.5*sx-0.5, 0,sy,0.5*sy-0.5);
+        }
+        else
+        {
+            szo = szi;
+            cv::Point2f c((szi.width-1)/2.0, (szi.height-1)/2.0);
+            cv::Mat R = cv::getRotationMatrix2D(c, o.dgr, 1.0);
+            cv::Mat Ri;
+            cv::invertAffineTransform(R, Ri);
+            A = cv::Matx23d((double*)Ri.data);
+        }
+        m.create(szo, CV_32FC2);
+        parallel_for(szo.height, [&](int y0, int y1){
+            for(int y=y0;y<y1;y++)
+            {
+                auto pm = m.ptr<cv::Vec2f>(y);
+                for(int x=0;x<szo.width;x++)
+                    pm[x] = cv::Vec2f(
+                        A(0,0)*x + A(0,1)*y + A(0,2),
+                        A(1,0)*x + A(1,1)*y + A(1,2));
+            }
+        });
+        return m;
+    }
+    //---- type after per-pixel op
+    int pix_type(const Op& o, int t)
+    {
+        int d = CV_MAT_DEPTH(t);
+        if(o.type==10) return CV_MAKETYPE(d, 1);
+        if(o.type==11) return CV_MAKETYPE(d, 3);
+        if(o.type==12) return CV_8UC1;
+        return t;
+    }
+    //---- codes of toGray/toHsv from space c,
+    //   through BGR like ImgCv::cvt().
+    bool cvt_codes(Op& o, Img::ClrSpc c)
+    {
+        using C = Img::ClrSpc;
+        o.codes.clear();
+        C t = (o.type==10) ? C::GRAY : C::HSV;
+        if(c==t) return true;
+        if(c==C::UNKNOWN) return false;
+        if(c==C::GRAY) o.codes.push_back(cv::COLOR_GRAY2BGR);
+        if(c==C::HSV)  o.codes.push_back(cv::COLOR_HSV2BGR);
+        o.codes.push_back((t==C::GRAY) ? cv::COLOR_BGR2GRAY :
+                                         cv::COLOR_BGR2HSV);
+        return true;
+    }
+    //---- colour space after op, filter gives
+    //   a single channel mask.
+    Img::ClrSpc op_cs(const Op& o, Img::ClrSpc c)
+    {
+        using C = Img::ClrSpc;
+        if(o.type==10 || o.type==12) return C::GRAY;
+        if(o.type==11) return C::HSV;
+        return c;
+    }
+    //----
+    void pix_op(const Op& o, const cv::Mat& i, cv::Mat& r)
+    {
+        if(o.type==10 || o.type==11)
+        {
+            //---- via BGR for GRAY <-> HSV
+            cv::Mat t = i, tb;
+            for(size_t k=0;k<o.codes.size();k++)
+            {
+                cv::Mat& d = (k+1==o.codes.size()) ? r : tb;
+                cv::cvtColor(t, d, o.codes[k]);
+                t = d;
+            }
+        }
+        else if(o.type==12)
+            cv::inRange(i, o.c0, o.c1, r);
+        else if(o.type==13)
+            cv::blur(i, r, cv::Size(o.w, o.w));
+    }
+    //------------
+    // Pass
+    //------------
+    // one remap (optional) and the per-pixel
+    //   ops following it.
+    struct Pass{
+        vector<int> geo, pix; // op index
+        //---- cached composed map
+        cv::Size szi{0,0}, szo{0,0};
+        cv::Mat map1, map2;
+        int interp = cv::INTER_LINEAR;
+        //----
+        void upd_map(const vector<Op>& ops, const cv::Size& sz);
+        int halo(const vector<Op>& ops)const;
+        void run(const vector<Op>& ops,
+                 const cv::Mat& imi, cv::Mat& imo);
+    };
+    //----
+    void Pass::upd_map(const vector<Op>& ops, const cv::Size& sz)
+    {
+        if(geo.empty() || sz==szi) return;
+        szi = sz;
+        cv::Mat M;
+        cv::Size s = sz;
+        interp = cv::INTER_NEAREST;
+        for(auto i : geo)
+        {
+            auto& o = ops[i];
+            cv::Size so;
+            cv::Mat N = geo_map(o, s, so);
+            interp = std::max(interp,
+                (o.type==0) ? o.method : (int)cv::INTER_LINEAR);
+            //---- M(N(x)) : sample previous map
+            //   at this op's input coords.
+            if(M.empty()) M = N;
+            else
+            {
+                cv::Mat Mn;
+                float b = lc_.map_out;
+                cv::remap(M, Mn, N, cv::noArray(),
+                    cv::INTER_LINEAR, cv::BORDER_CONSTANT,
+                    cv::Scalar(b, b));
+                M = Mn;
+            }
+            s = so;
+        }
+        szo = s;
+        cv::convertMaps(M, cv::noArray(), map1, map2,
+                        CV_16SC2, interp==cv::INTER_NEAREST);
+    }
+    //---- rows each band needs beyond its own
+    int Pass::halo(const vector<Op>& ops)const
+    {
+        int h = 0;
+        for(auto i : pix)
+            if(ops[i].type==13)
+                h += ops[i].w/2 + 1;
+        return h;
+    }
+    //----
+    void Pass::run(const vector<Op>& ops,
+                   const cv::Mat& imi, cv::Mat& imo)
+    {
+        upd_map(ops, imi.size());
+        cv::Size sz = geo.empty() ? imi.size() : szo;
+        int t = imi.type();
+        for(auto i : pix)
+            t = pix_type(ops[i], t);
+        imo.allocator = poolAlloc();
+        imo.create(sz, t);
+        //----
+        int H = sz.height;
+        int hl = halo(ops);
+        int R = lc_.band_rows;
+        int N = (H + R - 1)/R;
+        parallel_for(N, [&](int i0, int i1){
+            cv::Mat bf[2];
+            bf[0].allocator = bf[1].allocator = poolAlloc();
+            for(int i=i0;i<i1;i++)
+            {
+                int y0 = i*R;
+                int y1 = std::min(H, y0 + R);
+                int ya = std::max(0, y0 - hl);
+                int yb = std::min(H, y1 + hl);
+                cv::Mat ybo = imo.rowRange(y0, y1);
+                bool bDirect = (ya==y0 && yb==y1);
+                //---- resample band, or view input rows
+                cv::Mat b;
+                if(geo.empty())
+                    b = imi.rowRange(ya, yb);
+                else
+                {
+                    cv::Mat& r = (pix.empty()) ? ybo : bf[0];
+                    cv::remap(imi, r,
+                        map1.rowRange(ya, yb),
+                        map2.empty() ? cv::Mat() :
+                                       map2.rowRange(ya, yb),
+                        interp, cv::BORDER_CONSTANT);
+                    b = r;
+                }
+                //---- per-pixel chain, ping-pong buffers,
+                //   last op straight into output if no halo.
+                for(size_t k=0;k<pix.size();k++)
+                {
+                    if(ops[pix[k]].isNop()) continue;
+                    bool bLast = (k+1==pix.size());
+                    cv::Mat& r = (bLast && bDirect) ? ybo :
+                                 (b.data==bf[0].data) ? bf[1] : bf[0];
+                    pix_op(ops[pix[k]], b, r);
+                    b = r;
+                }
+                if(b.data!=ybo.data)
+                    b.rowRange(y0-ya, y1-ya).copyTo(ybo);
+            }
+        });
+    }
+
+    //------------
+    // ImgOpsCv
+    //------------
+    class ImgOpsCv : public ImgOps{
+    public:
+        virtual ImgOps& scale(const Sz& sz, int method)override
+        {   Op o; o.type = 0; o.sz = {sz.w, sz.h};
+            o.method = method; return add(o); }
+        virtual ImgOps& rot(double dgr)override
+        {   Op o; o.type = 1; o.dgr = dgr; return add(o); }
+        virtual ImgOps& undistort(const CamCfg& cc)override
+        {   Op o; o.type = 2;
+            eigen2cv(cc.K, o.Kc);
+            eigen2cv(cc.D.V(), o.Dc);
+            return add(o); }
+        virtual ImgOps& toGray()override
+        {   Op o; o.type = 10; return add(o); }
+        virtual ImgOps& toHsv()override
+        {   Op o; o.type = 11; return add(o); }
+        virtual ImgOps& filter(const HSV& c0, const HSV& c1)override
+        {   Op o; o.type = 12;
+            o.c0 = toCv(c0); o.c1 = toCv(c1); return add(o); }
+        virtual ImgOps& blur(int w)override
+        {   Op o; o.type = 13; o.w = w; return add(o); }
+        virtual void clear()override
+        { ops_.clear(); passes_.clear(); }
+        virtual size_t size()const override
+        { return ops_.size(); }
+        virtual int N_pass()const override
+        { return passes_.size(); }
+        virtual Sp<Img> run(const Img& im)override;
+    protected:
+        vector<Op> ops_;
+        vector<Pass> passes_;
+        ImgOps& add(const Op& o);
+    };
+    //---- new pass if geometric op after per-pixel
+    ImgOps& ImgOpsCv::add(const Op& o)
+    {
+        int i = ops_.size();
+        ops_.push_back(o);
+        bool bNew = passes_.empty() ||
+            (o.isGeo() && !passes_.back().pix.empty());
+        if(bNew) passes_.push_back(Pass());
+        auto& p = passes_.back();
+        if(o.isGeo())
+        {   p.geo.push_back(i); p.szi = {0,0}; }
+        else p.pix.push_back(i);
+        return *this;
+    }
+    //----
+    Sp<Img> ImgOpsCv::run(const Img& im)
+    {
+        cv::Mat imc = ImgCv(im).raw();
+        if(imc.empty())
+        {
+            log_e("ImgOps::run() empty img");
+            return nullptr;
+        }
+        if(passes_.empty())
+            return im.copy();
+        //---- colour ops from the space they see,
+        //   untagged input by channels.
+        using C = Img::ClrSpc;
+        auto ce = im.clrSpc();
+        if(ce==C::UNKNOWN)
+            ce = (imc.channels()==1) ? C::GRAY :
+                 (imc.channels()==3) ? C::BGR : C::UNKNOWN;
+        for(auto& o : ops_)
+        {
+            if((o.type==10 || o.type==11) && !cvt_codes(o, ce))
+            {
+                log_e("ImgOps::run() unknown colour space");
+                return nullptr;
+            }
+            ce = op_cs(o, ce);
+        }
+        for(auto& p : passes_)
+        {
+            cv::Mat imo;
+            p.run(ops_, imc, imo);
+            imc = imo;
+        }
+        auto cs = im.clrSpc();
+        for(auto& o : ops_)
+            cs = op_cs(o, cs);
+        auto p = mkSp<ImgCv>(imc);
+        p->setClrSpc(cs);
+        p->frm = im.frm;
+        return p;
+    }
+}
+
+//----
+Sp<ImgOps> ImgOps::create()
+{
+    return mkSp<ImgOpsCv>();
+}
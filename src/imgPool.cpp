@@ -0,0 +1,176 @@
+#include "vsn/vsnLibCv.h"
+
+using namespace vsn;
+using namespace ut;
+
+namespace{
+    //------------
+    // PoolAlloc
+    //------------
+    // cv::MatAllocator recycling buffers by
+    //   (bytes, type). Same layout rules as 
+    //   OpenCV StdMatAllocator, type kept in
+    //   UMatData::allocatorFlags_ for release.
+    class PoolAlloc : public cv::MatAllocator{
+    public:
+        using Key = pair<size_t, int>;
+        //----
+        cv::UMatData* allocate(int dims, const int* sizes, int type,
+                               void* data0, size_t* step, 
+                               cv::AccessFlag flags, 
+                               cv::UMatUsageFlags usageFlags)const override
+        {
+            size_t total = CV_ELEM_SIZE(type);
+            for(int i=dims-1; i>=0; i--)
+            {
+                if(step)
+                {
+                    if(data0 && step[i]!=CV_AUTOSTEP)
+                    {
+                        CV_Assert(total <= step[i]);
+                        total = step[i];
+                    }
+                    else step[i] = total;
+                }
+                total *= sizes[i];
+            }
+            auto p = (uchar*)data0;
+            if(p==nullptr)
+                p = take({total, type});
+            auto u = new cv::UMatData(this);
+            u->data = u->origdata = p;
+            u->size = total;
+            u->allocatorFlags_ = type;
+            if(data0)
+                u->flags |= cv::UMatData::USER_ALLOCATED;
+            return u;
+        }
+        //----
+        bool allocate(cv::UMatData* u, cv::AccessFlag, 
+                      cv::UMatUsageFlags)const override
+        { return u!=nullptr; }
+        //----
+        void deallocate(cv::UMatData* u)const override
+        {
+            if(u==nullptr) return;
+            CV_Assert(u->urefcount == 0);
+            CV_Assert(u->refcount == 0);
+            if(!(u->flags & cv::UMatData::USER_ALLOCATED))
+            {
+                give({u->size, u->allocatorFlags_}, u->origdata);
+                u->origdata = 0;
+            }
+            delete u;
+        }
+        //----
+        ImgPool::Cfg cfg_;
+        mutable std::mutex mtx_;
+        void clear();
+        ImgPool::Stats stats()const
+        {   std::unique_lock<std::mutex> lk(mtx_);
+            return st_; }
+    protected:
+        mutable map<Key, vector<uchar*>> idle_;
+        mutable ImgPool::Stats st_;
+        uchar* take(const Key& k)const;
+        void give(const Key& k, uchar* p)const;
+    };
+    //----
+    uchar* PoolAlloc::take(const Key& k)const
+    {
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            st_.bytesUsed += k.first;
+            auto it = idle_.find(k);
+            if(it!=idle_.end() && !it->second.empty())
+            {
+                auto p = it->second.back();
+                it->second.pop_back();
+                st_.bytesIdle -= k.first;
+                st_.hits++;
+                return p;
+            }
+            st_.misses++;
+        }
+        return (uchar*)cv::fastMalloc(k.first);
+    }
+    //----
+    void PoolAlloc::give(const Key& k, uchar* p)const
+    {
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            st_.bytesUsed -= k.first;
+            if(cfg_.en && 
+               st_.bytesIdle + k.first <= cfg_.maxIdle)
+            {
+                idle_[k].push_back(p);
+                st_.bytesIdle += k.first;
+                return;
+            }
+        }
+        cv::fastFree(p);
+    }
+    //----
+    void PoolAlloc::clear()
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        for(auto& it : idle_)
+            for(auto p : it.second)
+                cv::fastFree(p);
+        idle_.clear();
+        st_.bytesIdle = 0;
+    }
+    //---- never freed, Mats may outlive statics.
+    PoolAlloc& pool()
+    {
+        static PoolAlloc* p = new PoolAlloc();
+        return *p;
+    }
+}
+
+//----
+cv::MatAllocator* vsn::poolAlloc()
+{
+    auto& p = pool();
+    std::unique_lock<std::mutex> lk(p.mtx_);
+    return p.cfg_.en ? &p : nullptr;
+}
+
+//------------
+// ImgPool
+//------------
+void ImgPool::setCfg(const Cfg& c)
+{
+    auto& p = pool();
+    {
+        std::unique_lock<std::mutex> lk(p.mtx_);
+        p.cfg_ = c;
+    }
+    if(!c.en) p.clear();
+}
+//----
+ImgPool::Cfg ImgPool::getCfg()
+{
+    auto& p = pool();
+    std::unique_lock<std::mutex> lk(p.mtx_);
+    return p.cfg_;
+}
+//----
+ImgPool::Stats ImgPool::stats()
+{
+    return pool().stats();
+}
+//----
+void ImgPool::clear()
+{
+    pool().clear();
+}
+//----
+string ImgPool::Stats::str()const
+{
+    stringstream s;
+    s << "hits=" << hits << ", misses=" << misses;
+    s << ", idle=" << (bytesIdle >> 20) << "MB";
+    s << ", used=" << (bytesUsed >> 20) << "MB";
+    return s.str();
+}
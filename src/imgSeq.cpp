@@ -0,0 +1,278 @@
+#include "vsn/vsnLibCv.h"
+#include <thread>
+#include <condition_variable>
+#include <filesystem>
+
+using namespace vsn;
+using namespace ocv;
+using namespace ut;
+
+namespace{
+    //---- last digit run of file stem,
+    //   e.g. "000123.png" -> 123, -1 if none.
+    int fileIdx(CStr& sf)
+    {
+        string s = std::filesystem::path(sf).stem().string();
+        int i1 = s.size();
+        while(i1>0 && !isdigit(s[i1-1])) i1--;
+        int i0 = i1;
+        while(i0>0 && isdigit(s[i0-1])) i0--;
+        if(i0==i1) return -1;
+        return std::stoi(s.substr(i0, i1-i0));
+    }
+    //---- file name number of each, false if
+    //   any has none.
+    bool fileIdxs(const vector<cv::String>& sfs, vector<int>& ids)
+    {
+        ids.clear();
+        for(auto& sf : sfs)
+        {
+            int i = fileIdx(sf);
+            if(i<0) return false;
+            ids.push_back(i);
+        }
+        return true;
+    }
+    //---- imread flag of Cfg::dec, JPEG decoder
+    //   skips the DCT detail it doesn't need.
+    int rdFlag(int cvFlag, int dec)
+    {
+        bool bG = (cvFlag==cv::IMREAD_GRAYSCALE);
+        if(!bG && cvFlag!=cv::IMREAD_COLOR) return cvFlag;
+        if(dec==2) return bG ? cv::IMREAD_REDUCED_GRAYSCALE_2 :
+                               cv::IMREAD_REDUCED_COLOR_2;
+        if(dec==4) return bG ? cv::IMREAD_REDUCED_GRAYSCALE_4 :
+                               cv::IMREAD_REDUCED_COLOR_4;
+        if(dec==8) return bG ? cv::IMREAD_REDUCED_GRAYSCALE_8 :
+                               cv::IMREAD_REDUCED_COLOR_8;
+        return cvFlag;
+    }
+    //---- decode, tagged with colour space
+    Sp<Img> decode(CStr& sf, int cvFlag, int dec=1)
+    {
+        cv::Mat m = cv::imread(sf, rdFlag(cvFlag, dec));
+        if(m.empty())
+        {
+            log_ef(sf);
+            return nullptr;
+        }
+        auto p = mkSp<ImgCv>(m);
+        if(cvFlag==cv::IMREAD_GRAYSCALE)
+            p->setClrSpc(Img::ClrSpc::GRAY);
+        else if(cvFlag==cv::IMREAD_COLOR)
+            p->setClrSpc(Img::ClrSpc::BGR);
+        return p;
+    }
+
+    //------------
+    // ImgSeqCv
+    //------------
+    class ImgSeqCv : public ImgSeq{
+    public:
+        ~ImgSeqCv(){ close(); }
+        bool init(CStr& sL, const Cfg& c, CStr& sR);
+        virtual Sp<Img> read()override
+        {   Sp<Img> pL, pR;
+            readLR(pL, pR); return pL; }
+        virtual bool readLR(Sp<Img>& pL, Sp<Img>& pR)override;
+        virtual int size()const override
+        { return frms_.size(); }
+        virtual int frmIdx()const override{ return frmIdx_; }
+        virtual string sFile()const override{ return sFile_; }
+        virtual void close()override;
+    protected:
+        Cfg scfg_;
+        struct Frm{ string sL, sR; int idx=0; };
+        vector<Frm> frms_;
+        struct Slot{ Sp<Img> pL, pR; };
+        //---- shared with workers
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        map<int, Slot> buf_; // reorder buffer
+        int next_ = 0; // next frame to claim
+        int rd_   = 0; // next frame to read
+        bool bStop_ = false;
+        vector<std::thread> thds_;
+        //----
+        int frmIdx_ = -1;
+        string sFile_;
+        void worker();
+    };
+    //----
+    bool ImgSeqCv::init(CStr& sL, const Cfg& c, CStr& sR)
+    {
+        scfg_ = c;
+        scfg_.N_thd = std::max(c.N_thd, 1);
+        scfg_.N_buf = std::max(c.N_buf, 1);
+        vector<cv::String> sfLs, sfRs;
+        cv::glob(sL, sfLs);
+        if(sR!="") cv::glob(sR, sfRs);
+        if(sfLs.empty())
+        {
+            log_e("ImgSeq: no img found:'"+sL+"'");
+            return false;
+        }
+        //---- pair L/R by file name number,
+        //   or by position
+        vector<int> idLs, idRs;
+        bool bIdx = fileIdxs(sfLs, idLs) &&
+                    (sR=="" || fileIdxs(sfRs, idRs));
+        map<int, string> mR;
+        if(bIdx)
+            for(int i=0;i<idRs.size();i++)
+                mR[idRs[i]] = sfRs[i];
+        vector<Frm> fs;
+        for(int i=0;i<sfLs.size();i++)
+        {
+            Frm f;
+            f.sL = sfLs[i];
+            f.idx = bIdx ? idLs[i] : i;
+            if(sR!="")
+            {
+                if(bIdx)
+                {
+                    auto it = mR.find(f.idx);
+                    if(it==mR.end())
+                    {
+                        log_i("ImgSeq: no right img for:"+f.sL);
+                        continue;
+                    }
+                    f.sR = it->second;
+                }
+                else if(i < sfRs.size())
+                    f.sR = sfRs[i];
+                else break;
+            }
+            fs.push_back(f);
+        }
+        //---- range and stride
+        int N = fs.size();
+        int i1 = (c.end<0) ? N : std::min(c.end, N);
+        int st = std::max(c.stride, 1);
+        for(int i=std::max(c.start, 0); i<i1; i+=st)
+            frms_.push_back(fs[i]);
+        if(frms_.empty())
+        {
+            log_e("ImgSeq: empty frame range");
+            return false;
+        }
+        //---- size from first readable frame, kept
+        //   in buf_ so workers start after it.
+        int i0 = 0;
+        Slot sl;
+        for(;i0<frms_.size();i0++)
+        {
+            sl.pL = decode(frms_[i0].sL, c.cvFlag, c.dec);
+            if(sl.pL!=nullptr) break;
+            log_i("ImgSeq: skip unreadable frame:"+frms_[i0].sL);
+        }
+        if(sl.pL==nullptr)
+        {
+            log_e("ImgSeq: no readable frame");
+            return false;
+        }
+        if(frms_[i0].sR!="")
+            sl.pR = decode(frms_[i0].sR, c.cvFlag, c.dec);
+        Video::cfg_.sz = sl.pL->size();
+        buf_[i0] = sl;
+        rd_ = i0;
+        next_ = i0+1;
+        //----
+        stringstream s;
+        s << "ImgSeq open:'" << sL << "'";
+        if(sR!="") s << ", '" << sR << "'";
+        auto& sz = Video::cfg_.sz;
+        s << ", frames:" << frms_.size()
+          << ", size:" << sz.w << "x" << sz.h
+          << ", threads:" << scfg_.N_thd;
+        log_i(s.str());
+        for(int i=0;i<scfg_.N_thd;i++)
+            thds_.emplace_back([this](){ worker(); });
+        return true;
+    }
+    //---- claim frames in order, stay within
+    //   N_buf of the reader.
+    void ImgSeqCv::worker()
+    {
+        int N = frms_.size();
+        while(1)
+        {
+            int i = 0;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                cv_.wait(lk, [&](){ return bStop_ ||
+                    next_ >= N || next_ < rd_ + scfg_.N_buf; });
+                if(bStop_ || next_ >= N) return;
+                i = next_++;
+            }
+            auto& f = frms_[i];
+            Slot sl;
+            sl.pL = decode(f.sL, scfg_.cvFlag, scfg_.dec);
+            if(f.sR!="")
+                sl.pR = decode(f.sR, scfg_.cvFlag, scfg_.dec);
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                buf_[i] = sl;
+            }
+            cv_.notify_all();
+        }
+    }
+    //---- unreadable frames are logged and
+    //   skipped, false only at end or close.
+    bool ImgSeqCv::readLR(Sp<Img>& pL, Sp<Img>& pR)
+    {
+        while(1)
+        {
+            pL = pR = nullptr;
+            int i = 0;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                if(rd_ >= (int)frms_.size() || thds_.empty())
+                    return false;
+                cv_.wait(lk, [&](){ return bStop_ ||
+                    buf_.find(rd_)!=buf_.end(); });
+                if(bStop_) return false;
+                auto it = buf_.find(rd_);
+                pL = it->second.pL;
+                pR = it->second.pR;
+                buf_.erase(it);
+                i = rd_++;
+            }
+            cv_.notify_all();
+            auto& f = frms_[i];
+            bool ok = (pL!=nullptr) &&
+                      (f.sR=="" || pR!=nullptr);
+            if(!ok)
+            {
+                log_i("ImgSeq: skip unreadable frame:"+f.sL);
+                continue;
+            }
+            frmIdx_ = f.idx;
+            sFile_ = f.sL;
+            for(auto p : {pL, pR})
+                if(p!=nullptr)
+                {   p->frm.seq = i; p->frm.idx = f.idx; }
+            return true;
+        }
+    }
+    //----
+    void ImgSeqCv::close()
+    {
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            bStop_ = true;
+        }
+        cv_.notify_all();
+        for(auto& t : thds_) t.join();
+        thds_.clear();
+        buf_.clear();
+    }
+}
+//----
+Sp<ImgSeq> ImgSeq::create(CStr& sL, const Cfg& c, CStr& sR)
+{
+    auto p = mkSp<ImgSeqCv>();
+    if(!p->init(sL, c, sR))
+        return nullptr;
+    return p;
+}
@@ -0,0 +1,149 @@
+#include "vsn/vsnLibCv.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace vsn;
+using namespace ocv;
+using namespace ut;
+
+namespace{
+    //------------
+    // ExtAlloc
+    //------------
+    // Owner of wrapped buffers. Never allocates,
+    //   only runs the release callback kept in
+    //   UMatData::userdata when refcount drops to 0.
+    class ExtAlloc : public cv::MatAllocator{
+    public:
+        cv::UMatData* allocate(int dims, const int* sizes, int type,
+                               void* data0, size_t* step,
+                               cv::AccessFlag flags,
+                               cv::UMatUsageFlags usageFlags)const override
+        {
+            // not set as Mat::allocator, delegate anyway.
+            return cv::Mat::getStdAllocator()->allocate(
+                dims, sizes, type, data0, step, flags, usageFlags);
+        }
+        bool allocate(cv::UMatData* u, cv::AccessFlag,
+                      cv::UMatUsageFlags)const override
+        { return u!=nullptr; }
+        //----
+        void deallocate(cv::UMatData* u)const override
+        {
+            if(u==nullptr) return;
+            auto p_f = (function<void()>*)u->userdata;
+            u->userdata = nullptr;
+            if(p_f!=nullptr)
+            {
+                if(*p_f) (*p_f)();
+                delete p_f;
+            }
+            u->data = u->origdata = nullptr;
+            delete u;
+        }
+    };
+    //---- never freed, Mats may outlive statics.
+    ExtAlloc& extAlloc()
+    {
+        static ExtAlloc* p = new ExtAlloc();
+        return *p;
+    }
+    //---- mmap buf from fd, fd can be closed after.
+    Sp<Img> mapFd(int fd, Img::Buf b, size_t ofs,
+                  bool wr, CStr& s)
+    {
+        int type = CV_MAKETYPE((int)b.depth, b.chn);
+        size_t rowSz = size_t(b.w)*CV_ELEM_SIZE(type);
+        if(b.step==0) b.step = rowSz;
+        size_t sz = b.step*(b.h-1) + rowSz;
+        struct stat st;
+        if(b.w<=0 || b.h<=0 || fstat(fd, &st)!=0 ||
+           size_t(st.st_size) < ofs + sz)
+        {
+            log_e("Img map '"+s+"' smaller than img");
+            return nullptr;
+        }
+        //---- mmap offset must be page aligned
+        size_t pg = sysconf(_SC_PAGESIZE);
+        size_t ofs0 = ofs - ofs%pg;
+        size_t len = sz + (ofs - ofs0);
+        void* pm = mmap(nullptr, len, PROT_READ|PROT_WRITE,
+                        wr ? MAP_SHARED : MAP_PRIVATE, fd, ofs0);
+        if(pm==MAP_FAILED)
+        {
+            log_e("Img map '"+s+"' mmap failed");
+            return nullptr;
+        }
+        Img::Ext e;
+        e.buf = b;
+        e.buf.p = (uint8_t*)pm + (ofs - ofs0);
+        e.release = [pm, len](){ munmap(pm, len); };
+        return Img::wrap(e);
+    }
+}
+
+//------------
+// wrap
+//------------
+Sp<Img> Img::wrap(const Ext& e)
+{
+    auto& b = e.buf;
+    if(b.p==nullptr || b.w<=0 || b.h<=0 || b.chn<=0)
+    {
+        log_e("Img::wrap() invalid buf");
+        return nullptr;
+    }
+    int type = CV_MAKETYPE((int)b.depth, b.chn);
+    size_t rowSz = size_t(b.w)*CV_ELEM_SIZE(type);
+    size_t step = (b.step>0) ? b.step : rowSz;
+    if(step < rowSz)
+    {
+        log_e("Img::wrap() step less than row size");
+        return nullptr;
+    }
+    //---- Mat header on the buffer, refcounted
+    //   through our own UMatData so crop() views
+    //   keep it alive.
+    cv::Mat m(b.h, b.w, type, b.p, step);
+    auto u = new cv::UMatData(&extAlloc());
+    u->data = u->origdata = b.p;
+    u->size = step*(b.h-1) + rowSz;
+    u->userdata = new function<void()>(e.release);
+    u->refcount = 1;
+    m.u = u;
+    // ops that must reallocate take from pool
+    m.allocator = poolAlloc();
+    auto p = mkSp<ImgCv>(m);
+    p->setExt(e.onRealloc);
+    return p;
+}
+//----
+Sp<Img> Img::mapFile(CStr& sf, const Buf& b,
+                     size_t ofs, bool wr)
+{
+    int fd = ::open(sf.c_str(), wr ? O_RDWR : O_RDONLY);
+    if(fd<0)
+    {
+        log_ef(sf);
+        return nullptr;
+    }
+    auto p = mapFd(fd, b, ofs, wr, sf);
+    ::close(fd); // mapping stays valid
+    return p;
+}
+//----
+Sp<Img> Img::mapShm(CStr& sName, const Buf& b,
+                    size_t ofs, bool wr)
+{
+    int fd = shm_open(sName.c_str(), wr ? O_RDWR : O_RDONLY, 0);
+    if(fd<0)
+    {
+        log_e("Img::mapShm() failed to open '"+sName+"'");
+        return nullptr;
+    }
+    auto p = mapFd(fd, b, ofs, wr, sName);
+    ::close(fd);
+    return p;
+}
@@ -15,48 +15,297 @@ namespace{
     struct LCfg{
         // very small specle filter
         float box_area_TH = 30*30;
+        // front end band working set, 
+        //   about L2 cache per thread.
+        int band_bytes = 128*1024;
+        int band_rows_min = 16;
+        // class bits per pixel
+        int N_cls_max = 8;
+        // binary threshold after blur
+        int bin_TH = 150;
     }; LCfg lc_;
     //----
     void conv_pnts(const vector<cv::Point>& ps, vec2s& vs)
     { for(auto& p : ps)vs.push_back({p.x, p.y}); }
     void conv_pnts(const vec2s& vs, vector<cv::Point>& ps)
     { for(auto& v : vs)ps.push_back(cv::Point(v.x(), v.y())); }
-    //------
     //------------
-    // for red block test case
-    Sp<Img> hsv_hue_shift90(const Img& imi)
-    {
-        auto p = imi.copy();
-        auto& im = *p;
-        Sz sz = im.size();
-        for(int y=0;y<sz.h;y++)
-            for(int x=0;x<sz.w;x++)
+    // HSV range LUT
+    //------------
+    // Per channel 256-entry table, bit k set if 
+    //   the channel value is in range of class k.
+    //   The optional hue rotation (for red around
+    //   0/180) is folded into the hue table, so 
+    //   filter and shift of all classes cost one
+    //   lookup per channel.
+    using Cls = InstSegm::Cfg::Cls;
+    struct HsvLut{
+        uint8_t h[256];
+        uint8_t s[256];
+        uint8_t v[256];
+        void init(const vector<Cls>& cs);
+    };
+    //----
+    void HsvLut::init(const vector<Cls>& cs)
+    {
+        memset(h, 0, sizeof(h));
+        memset(s, 0, sizeof(s));
+        memset(v, 0, sizeof(v));
+        for(int k=0;k<cs.size();k++)
+        {
+            auto& c0 = cs[k].filter.c0;
+            auto& c1 = cs[k].filter.c1;
+            uint8_t bit = 1 << k;
+            for(int i=0;i<256;i++)
+            {
+                unsigned int hi = i;
+                if(cs[k].enHueShift90)
+                {
+                    hi += 90;
+                    if(hi>180) hi -= 180;
+                }
+                if(hi>=c0.h && hi<=c1.h) h[i] |= bit;
+                if(i >=c0.s && i <=c1.s) s[i] |= bit;
+                if(i >=c0.v && i <=c1.v) v[i] |= bit;
+            }
+        }
+    }
+    //------------
+    // Fused hue shift + range filter,
+    //   HSV img in, class bits out, one pass.
+    //   Returns OR of all bits, i.e. classes
+    //   present in imh.
+    uint8_t hsv_mask(const cv::Mat& imh, 
+                     const HsvLut& lut, 
+                     cv::Mat& imf)
+    {
+        assert(imh.type()==CV_8UC3);
+        imf.create(imh.size(), CV_8UC1);
+        int W = imh.cols;
+        uint8_t bs = 0;
+        for(int y=0; y<imh.rows; y++)
+        {
+            auto ps = imh.ptr<HSV>(y);
+            auto pm = imf.ptr<uint8_t>(y);
+            for(int x=0; x<W; x++)
+            {
+                auto& c = ps[x];
+                pm[x] = lut.h[c.h] & lut.s[c.s] & lut.v[c.v];
+                bs |= pm[x];
+            }
+        }
+        return bs;
+    }
+    //------------
+    // Fused front end
+    //------------
+    // BGR -> HSV -> class bits -> (per class) 
+    //   blur -> threshold -> label, run per 
+    //   horizontal band so intermediates stay 
+    //   in cache. Bands are extended by the blur
+    //   radius, so the result is identical to 
+    //   the full frame chain. Classes absent 
+    //   from a band (halo included) are not
+    //   blurred, blur of an empty plane is 0,
+    //   so cost follows the classes present
+    //   rather than the class count.
+    //   iml   : label img, 0 none, k+1 class k,
+    //           lower class wins on overlap.
+    //   p_imb : optional full frame blur output
+    //           of class 0.
+    //   bHsv  : imi already HSV, no conversion.
+    void front_end(const cv::Mat& imi, bool bHsv,
+                   const HsvLut& lut, 
+                   int Nc, int bsz,
+                   cv::Mat& iml,
+                   cv::Mat* p_imb = nullptr)
+    {
+        int W = imi.cols;
+        int H = imi.rows;
+        iml.allocator = poolAlloc();
+        iml.create(H, W, CV_8UC1);
+        if(p_imb!=nullptr)
+        {
+            p_imb->allocator = poolAlloc();
+            p_imb->create(H, W, CV_8UC1);
+        }
+        int halo = (bsz>1) ? bsz/2 : 0;
+        int Nr = lc_.band_bytes / std::max(W*3, 1);
+        Nr = std::max(Nr, lc_.band_rows_min);
+        int Nb = (H + Nr -1) / Nr;
+        uint8_t TH = lc_.bin_TH;
+        cv::parallel_for_(cv::Range(0, Nb), 
+        [&](const cv::Range& r){
+            cv::Mat imh, imf, imk, imb; // band buffers
+            for(int b=r.start; b<r.end; b++)
+            {
+                int y0 = b*Nr;
+                int y1 = std::min(y0 + Nr, H);
+                int y0h = std::max(y0 - halo, 0);
+                int y1h = std::min(y1 + halo, H);
+                if(bHsv)
+                    imh = imi.rowRange(y0h, y1h);
+                else
+                    cv::cvtColor(imi.rowRange(y0h, y1h), imh, 
+                                 cv::COLOR_BGR2HSV);
+                uint8_t bs = hsv_mask(imh, lut, imf);
+                imk.create(imf.size(), CV_8UC1);
+                for(int k=0;k<Nc;k++)
+                {
+                    if(!((bs >> k) & 1))
+                    {
+                        //---- nothing to label, class 0
+                        //   still owns the clear.
+                        if(k!=0) continue;
+                        iml.rowRange(y0, y1).setTo(0);
+                        if(p_imb!=nullptr)
+                            p_imb->rowRange(y0, y1).setTo(0);
+                        continue;
+                    }
+                    //---- class k plane, 0 / 255
+                    for(int y=0; y<imf.rows; y++)
+                    {
+                        auto pf = imf.ptr<uint8_t>(y);
+                        auto pk = imk.ptr<uint8_t>(y);
+                        for(int x=0; x<W; x++)
+                            pk[x] = (uint8_t)(-((pf[x] >> k) & 1));
+                    }
+                    if(bsz>0)
+                        cv::blur(imk, imb, cv::Size(bsz, bsz));
+                    cv::Mat& imr = (bsz>0) ? imb : imk;
+                    //---- threshold rows owned by band
+                    uint8_t l = k+1;
+                    for(int y=y0; y<y1; y++)
+                    {
+                        auto pb = imr.ptr<uint8_t>(y - y0h);
+                        auto pl = iml.ptr<uint8_t>(y);
+                        if(k==0)
+                            for(int x=0; x<W; x++)
+                                pl[x] = (pb[x] > TH) ? l : 0;
+                        else
+                            for(int x=0; x<W; x++)
+                                if(pl[x]==0 && pb[x] > TH) pl[x] = l;
+                    }
+                    if(k==0 && p_imb!=nullptr)
+                        imr.rowRange(y0 - y0h, y1 - y0h).copyTo(
+                            p_imb->rowRange(y0, y1));
+                }
+            }
+        });
+    }
+
+    //------------
+    // Instance extraction
+    //------------
+    // Result of all classes, areas[i] -1 if
+    //   culled as speckle (hull not computed).
+    struct Extr{
+        vector<vector<cv::Point>> contrs;
+        vector<vector<cv::Point>> hull;
+        vector<double> areas;
+        vector<int> cls;
+        void add(vector<cv::Point>& c, 
+                 vector<cv::Point>& h, 
+                 double a, int k)
+        {
+            contrs.push_back(std::move(c));
+            hull.push_back(std::move(h));
+            areas.push_back(a);
+            cls.push_back(k);
+        }
+    };
+    //---- by contours of whole mask,
+    //   ofs : offset of mask in frame.
+    void extr_cntrs(const cv::Mat& imk, int k, 
+                    const cv::Point& ofs, Extr& e)
+    {
+        vector<vector<cv::Point>> cs;
+        cv::findContours(imk, cs, cv::RETR_LIST, 
+                         cv::CHAIN_APPROX_SIMPLE, ofs);
+        for(auto& c : cs)
+        {
+            //--- min speckle filter, 
+            //  box of contour same as of hull.
+            cv::Rect b = cv::boundingRect(c);
+            double ab = b.width*b.height;
+            vector<cv::Point> h;
+            double a = -1;
+            if(ab >= lc_.box_area_TH)
             {
-                Px px(x,y);
-                HSV d; im.get(px, d);
-                unsigned int h = d.h;
-                // dbg
-                if(h< 3 || h > 175)
-                { int k=0; }
-                //
-                h += 90;
-                if(h>180) h -= 180;
-               // h = 90; // dbg
-                d.h = h;
-                im.set(px, d);
+                cv::convexHull(c, h, false);
+                a = cv::contourArea(h);
             }
-        //--- dbg
-        if(0)
+            e.add(c, h, a, k);
+        }
+    }
+    //---- by connected components, culled by 
+    //   area and box before any contour work.
+    //   Hull area <= box area, so box culling 
+    //   against areaTH is exact.
+    void extr_ccs(const cv::Mat& imk, int k, 
+                  const cv::Point& ofs,
+                  float areaTH, Extr& e)
+    {
+        cv::Mat lbl, stats, cents;
+        int n = cv::connectedComponentsWithStats(
+                    imk, lbl, stats, cents, 8, CV_32S);
+        for(int j=1;j<n;j++)
         {
-            cv::Mat imc = ImgCv(im).raw();
-            cv::Mat imd = imc;
-            cv::cvtColor(imc, imd,cv::COLOR_HSV2BGR);
-            imshow("Hue shift 90 RGB", imd);
-            imwrite("hue90.jpg", imd);
-        
+            auto st = stats.ptr<int>(j);
+            cv::Rect b(st[cv::CC_STAT_LEFT], st[cv::CC_STAT_TOP],
+                       st[cv::CC_STAT_WIDTH], st[cv::CC_STAT_HEIGHT]);
+            double ab = b.width*b.height;
+            if(ab < lc_.box_area_TH || ab < areaTH)
+                continue;
+            //---- contour of survivor only
+            cv::Mat imj = (lbl(b) == j);
+            vector<vector<cv::Point>> cs;
+            cv::findContours(imj, cs, cv::RETR_EXTERNAL, 
+                    cv::CHAIN_APPROX_SIMPLE, b.tl() + ofs);
+            if(cs.empty()) continue;
+            vector<cv::Point> c;
+            for(auto& ci : cs)
+                c.insert(c.end(), ci.begin(), ci.end());
+            vector<cv::Point> h;
+            cv::convexHull(c, h, false);
+            double a = cv::contourArea(h);
+            if(a < areaTH) continue;
+            e.add(c, h, a, k);
         }
-        return p;
+    }
 
+    //------------
+    // Search regions clipped to frame, and
+    //   merged so no pixel is visited twice.
+    //   Whole frame if none.
+    vector<cv::Rect> merge_rgns(const vector<ut::Rect>& rus, 
+                                const cv::Size& sz)
+    {
+        cv::Rect rf(cv::Point(0,0), sz);
+        if(rus.empty()) return {rf};
+        vector<cv::Rect> rs;
+        for(auto& ru : rus)
+        {
+            cv::Rect r = ocv::toCv(ru) & rf;
+            if(r.area()>0)
+                rs.push_back(r);
+        }
+        bool bMrg = true;
+        while(bMrg)
+        {
+            bMrg = false;
+            for(int i=0;i<rs.size() && !bMrg;i++)
+                for(int j=i+1;j<rs.size();j++)
+                {
+                    if((rs[i] & rs[j]).area()==0) 
+                        continue;
+                    rs[i] |= rs[j];
+                    rs.erase(rs.begin()+j);
+                    bMrg = true;
+                    break;
+                }
+        }
+        return rs;
     }
 
 }
@@ -70,59 +319,92 @@ bool InstSegm::onImg(const Img& im)
     using namespace cv;
     Sz sz = im.size();
     
-    auto& fc = cfg_.filter;
-    auto p_imi = im.copy();
-    p_imi->toHsv();
-    auto p_imc = p_imi;
-    if(cfg_.enHueShift90)
-        p_imc = hsv_hue_shift90(*p_imi);
-    
-    p_imc->filter(fc.c0, fc.c1);
-    cv::Mat imf = ImgCv(*p_imc).raw();    
-
-    // pre-process
-    cv::Mat imb = imf;
-    float bsz = cfg_.blurSz;
-    if(bsz>0)
+    //---- color classes, single 'filter' 
+    //   if not provided.
+    auto cs = cfg_.classes;
+    if(cs.empty())
+        cs.push_back({"", cfg_.filter, cfg_.enHueShift90});
+    int Nc = cs.size();
+    if(Nc > lc_.N_cls_max)
     {
-        blur(imf, imb, Size(bsz, bsz)); // apply blur to grayscaled image
-        data_.p_imb = mkSp<ImgCv>(imb);
+        log_e("InstSegm: too many color classes:"+
+                to_string(Nc));
+        return false;
+    }
+    HsvLut lut; 
+    lut.init(cs);
+    //---- intermediates only kept for output
+    bool bKeep = cfg_.en_imo || cfg_.enShow;
+    int bsz = cfg_.blurSz;
+    cv::Mat imi = ImgCv(im).raw();
+    bool bHsv = im.clrSpc()==Img::ClrSpc::HSV;
+    auto rgns = merge_rgns(track_rgns(), imi.size());
+    bool bFull = rgns.size()==1 && 
+                 rgns[0].size()==imi.size();
+    cv::Mat iml, imb;
+    if(bKeep && !bFull)
+    {
+        iml.allocator = poolAlloc();
+        iml.create(imi.size(), CV_8UC1);
+        iml = 0;
+        if(bsz>0)
+        {
+            imb.allocator = poolAlloc();
+            imb.create(imi.size(), CV_8UC1);
+            imb = 0;
+        }
     }
-    cv::Mat imt;
-    threshold(imb, imt, 150, 255, THRESH_BINARY); // apply binary thresholding
+    //---- segment and extract instance 
+    //   of each class in each region.
+    Extr e;
+    for(auto& r : rgns)
+    {
+        cv::Mat imlr, imbr;
+        front_end(imi(r), bHsv, lut, Nc, bsz, imlr, 
+                  (bKeep && bsz>0) ? &imbr : nullptr);
+        if(bFull)
+        { iml = imlr; imb = imbr; }
+        else if(bKeep)
+        {
+            imlr.copyTo(iml(r));
+            if(!imbr.empty())
+                imbr.copyTo(imb(r));
+        }
+        cv::Mat imk = imlr;
+        for(int k=0;k<Nc;k++)
+        {
+            if(Nc>1)
+                cv::compare(imlr, k+1, imk, CMP_EQ);
+            if(cfg_.extract==1)
+                extr_ccs(imk, k, r.tl(), cfg_.areaTH, e);
+            else
+                extr_cntrs(imk, k, r.tl(), e);
+        }
+    }
+    if(!iml.empty())
+        data_.p_iml = mkSp<ImgCv>(iml);
+    if(!imb.empty())
+        data_.p_imb = mkSp<ImgCv>(imb);
 
-    // find contours
-    vector< vector<Point> > contrs; // list of contour points
-    vector<Vec4i> hier;
-    findContours(imt, contrs, hier, RETR_TREE, CHAIN_APPROX_SIMPLE, Point(0, 0));
-    // create hull array for convex hull points
+    auto& contrs = e.contrs;
+    auto& hull = e.hull;
+    auto& areas = e.areas;
     int N = contrs.size();
-    vector< vector<Point> > hull(N);
-    vector<double> areas;
-    //vector<cv::Rect> bboxes;
-    
     for(int i = 0; i < N; i++)
     {
-        convexHull(Mat(contrs[i]), hull[i], false);
-        cv::Rect b = boundingRect(hull[i]);  
-        //--- min speckle filter
-        double ab = b.width*b.height;
-        if(ab < lc_.box_area_TH)
-            ab = -1;
-        //---- filter contour ara
-        double a=-1;
-        if(ab > 0)
-            a = contourArea(hull[i]);
-        areas.push_back(a);
-        if(a < cfg_.areaTH)
+        if(areas[i] < cfg_.areaTH)
             continue;
-
         //---- filter result
         Inst in;
-        in.box = ocv::toUt(b);  
+        in.cls = e.cls[i];
+        in.box = ocv::toUt(boundingRect(hull[i]));  
         conv_pnts(hull[i], in.hull);
         data_.ins.push_back(in);
     }
+    //---- temporal tracking
+    if(cfg_.track.en)
+        track(data_.ins);
+    trk_.frmIdx++;
 
     //---- show result
     if(!cfg_.en_imo)
@@ -134,7 +416,8 @@ bool InstSegm::onImg(const Img& im)
     auto p_imo = data_.p_imo;
     if(p_imo==nullptr)
     {
-        p_imo = im.copy();
+        p_imo = bHsv ? im.as(Img::ClrSpc::BGR)->copy() :
+                       im.copy();
         data_.p_imo = p_imo;
     }
     ImgCv imoc(*p_imo);
@@ -177,7 +460,13 @@ bool InstSegm::onImg(const Img& im)
         cv::rectangle(imo, b, ci, 2);
         //--- convex pnts
         p_imo->draw(in.hull, cp, 4);
+        //--- class name
+        auto& sCls = cs[in.cls].sName;
+        if(sCls!="")
+            p_imo->draw(sCls, ocv::toPx(b.tl())+Px(0, -10), cp);
     }
+    imoc.touch(); // drawn through im_
+    cv::Mat imt = (iml > 0);
     data_.p_imc = mkSp<ImgCv>(im_cntr);
     data_.p_imt = mkSp<ImgCv>(imt);
     //----
@@ -198,3 +487,87 @@ bool InstSegm::onImg(const Img& im)
     return true;
 }
 
+//-----------------
+// Dilated predicted boxes of tracked 
+//   instances, empty on full frame pass.
+vector<ut::Rect> InstSegm::track_rgns()const
+{
+    auto& tc = cfg_.track;
+    auto& ti = trk_.ins;
+    bool bFull = (!tc.en) || ti.empty() ||
+                 (tc.N_full<=1) ||
+                 (trk_.frmIdx % tc.N_full == 0);
+    if(bFull) return {};
+    vector<ut::Rect> rs;
+    for(auto& t : ti)
+    {
+        auto b = t.in.box;
+        b.cntr = toPx(px2v(b.cntr) + t.in.vel*(t.lost+1));
+        int d = std::max(b.sz.w, b.sz.h) * tc.dilate;
+        b.sz.w += d*2;
+        b.sz.h += d*2;
+        rs.push_back(b);
+    }
+    return rs;
+}
+//-----------------
+// Greedy nearest match of instances to
+//   tracks of same class, then assign 
+//   persistent id and velocity.
+void InstSegm::track(vector<Inst>& ins)
+{
+    auto& tc = cfg_.track;
+    auto& ti = trk_.ins;
+    //---- candidate pairs within gate
+    struct Pair{ int t,i; double d; };
+    vector<Pair> ps;
+    for(int t=0;t<ti.size();t++)
+    {
+        auto& tr = ti[t].in;
+        vec2 cp = px2v(tr.box.cntr) + tr.vel*(ti[t].lost+1);
+        auto& bs = tr.box.sz;
+        double gate = tc.matchTH * sqrt(bs.w*bs.w + bs.h*bs.h);
+        for(int i=0;i<ins.size();i++)
+        {
+            if(ins[i].cls != tr.cls) continue;
+            double d = (px2v(ins[i].box.cntr) - cp).norm();
+            if(d <= gate)
+                ps.push_back({t, i, d});
+        }
+    }
+    std::sort(ps.begin(), ps.end(), 
+        [](const Pair& a, const Pair& b){ return a.d < b.d; });
+    //---- assign
+    vector<bool> tUsed(ti.size(), false);
+    vector<bool> iUsed(ins.size(), false);
+    for(auto& p : ps)
+    {
+        if(tUsed[p.t] || iUsed[p.i]) continue;
+        tUsed[p.t] = iUsed[p.i] = true;
+        auto& tr = ti[p.t];
+        auto& in = ins[p.i];
+        // frame gap since last observation
+        double dt = tr.lost + 1;
+        in.id = tr.in.id;
+        in.vel = (px2v(in.box.cntr) - px2v(tr.in.box.cntr)) / dt;
+    }
+    //---- new tracks
+    for(int i=0;i<ins.size();i++)
+        if(!iUsed[i])
+            ins[i].id = trk_.nextId++;
+    //---- keep lost tracks for a while, box
+    //   stays at last observation, prediction
+    //   coasts on velocity by lost+1 frames.
+    vector<TrkDt::Trk> tn;
+    for(int t=0;t<ti.size();t++)
+    {
+        if(tUsed[t]) continue;
+        auto tr = ti[t];
+        tr.lost++;
+        if(tr.lost > tc.N_lost) continue;
+        tn.push_back(tr);
+    }
+    for(auto& in : ins)
+        tn.push_back({in, 0});
+    ti = tn;
+}
@@ -0,0 +1,125 @@
+#include "vsn/vsnLib.h"
+#include <unordered_map>
+#include <list>
+
+using namespace vsn;
+using namespace ut;
+
+namespace{
+    //---- voxel coords packed 21 bits each,
+    //   +/- 2^20 voxels per axis.
+    using Key = uint64_t;
+    Key voxKey(const vec3& P, double s)
+    {
+        const int64_t o = int64_t(1) << 20;
+        const int64_t m = (int64_t(1) << 21) - 1;
+        Key k = 0;
+        for(int i=0;i<3;i++)
+        {
+            int64_t v = (int64_t)std::floor(P[i]*s) + o;
+            k = (k << 21) | Key(v & m);
+        }
+        return k;
+    }
+    //---- running sums, divided on export
+    struct Vox{
+        vec3 sP{0,0,0};
+        uint32_t sc[3]{0,0,0};
+        uint32_t n = 0;
+        int frm = 0; // last updated
+        std::list<Key>::iterator it;
+    };
+
+    //------------
+    // PointMapImp
+    //------------
+    class PointMapImp : public PointMap{
+    public:
+        PointMapImp(const Cfg& c):cfg_(c){}
+        virtual void add(const Points& ps, 
+                         const mat3& Rw, const vec3& tw)override;
+        virtual Sp<Points> toPoints()const override
+        {   auto p = mkSp<Points>(); toPoints(*p); return p; }
+        virtual void toPoints(Points& ps)const override;
+        virtual size_t size()const override
+        { return voxs_.size(); }
+        virtual int N_frms()const override{ return frm_; }
+        virtual void clear()override
+        { voxs_.clear(); lru_.clear(); frm_ = 0; }
+    protected:
+        Cfg cfg_;
+        std::unordered_map<Key, Vox> voxs_;
+        // least recently updated first
+        std::list<Key> lru_;
+        int frm_ = 0;
+        void evict();
+    };
+    //----
+    void PointMapImp::add(const Points& ps, 
+                          const mat3& Rw, const vec3& tw)
+    {
+        frm_++;
+        double s = 1.0 / cfg_.reso;
+        size_t N = ps.size();
+        for(size_t i=0;i<N;i++)
+        {
+            auto p = ps.get(i);
+            if(!p.p.allFinite()) continue; // grid holes
+            vec3 P = Rw*p.p + tw;
+            Key k = voxKey(P, s);
+            auto r = voxs_.try_emplace(k);
+            auto& v = r.first->second;
+            if(r.second)
+                v.it = lru_.insert(lru_.end(), k);
+            else if(v.frm!=frm_)
+                lru_.splice(lru_.end(), lru_, v.it);
+            v.frm = frm_;
+            v.sP += P;
+            v.sc[0] += p.c.r; v.sc[1] += p.c.g; v.sc[2] += p.c.b;
+            v.n++;
+        }
+        evict();
+    }
+    //---- by age, then by count
+    void PointMapImp::evict()
+    {
+        auto& c = cfg_;
+        while(!lru_.empty())
+        {
+            auto& v = voxs_[lru_.front()];
+            bool bOld = c.age_max>0 && 
+                        frm_ - v.frm > c.age_max;
+            bool bFull = c.N_max>0 && 
+                        voxs_.size() > (size_t)c.N_max;
+            if(!bOld && !bFull) break;
+            voxs_.erase(lru_.front());
+            lru_.pop_front();
+        }
+    }
+    //----
+    void PointMapImp::toPoints(Points& ps)const
+    {
+        ps.clear();
+        for(auto& it : voxs_)
+        {
+            auto& v = it.second;
+            if(v.n < (uint32_t)cfg_.N_min) continue;
+            Points::Pnt q;
+            q.p = v.sP / v.n;
+            q.c = Color{uint8_t(v.sc[0]/v.n), 
+                        uint8_t(v.sc[1]/v.n), 
+                        uint8_t(v.sc[2]/v.n)};
+            ps.add(q);
+        }
+    }
+}
+//----
+Sp<PointMap> PointMap::create(const Cfg& c)
+{
+    if(c.reso<=0)
+    {
+        log_e("PointMap: reso must be > 0");
+        return nullptr;
+    }
+    return mkSp<PointMapImp>(c);
+}
@@ -13,6 +13,10 @@
 
 using namespace vsn;
 namespace{
+    struct LCfg{
+        size_t chunk = size_t(4) << 20; // Writer bytes
+        int N_digits = 12; // Writer header count
+    }; LCfg lc_;
     //----- utils 
     pclu::Pnt toPcl(const Points::Pnt& in)
     { 
@@ -50,6 +54,52 @@ namespace{
         auto& di = reinterpret_cast<DataImp&>(*p);
         return di.raw();
     }
+    //---- image window as neighbourhood, meanK
+    //   nearest of it, approximates kNN for 
+    //   clouds from disparity.
+    void filter_grid(const pclu::PCloud& pc, 
+                     const Points::FilterCfg& c,
+                     vector<float>& dm, 
+                     vector<uint8_t>& rok)
+    {
+        int W = pc.width, H = pc.height;
+        int r = std::max(c.win, 3)/2;
+        float rr = c.radius * c.radius;
+        parallel_for(H, [&](int v0, int v1){
+            vector<float> ds;
+            for(int v=v0;v<v1;v++)
+                for(int u=0;u<W;u++)
+                {
+                    auto& q = pc(u, v);
+                    if(!pcl::isFinite(q)) continue;
+                    ds.clear();
+                    int nr = 0;
+                    for(int y=std::max(0,v-r); y<=std::min(H-1,v+r); y++)
+                        for(int x=std::max(0,u-r); x<=std::min(W-1,u+r); x++)
+                        {
+                            auto& b = pc(x, y);
+                            if((x==u && y==v) || !pcl::isFinite(b))
+                                continue;
+                            float d2 = (b.getVector3fMap() - 
+                                        q.getVector3fMap()).squaredNorm();
+                            if(d2 <= rr) nr++;
+                            ds.push_back(d2);
+                        }
+                    int i = v*W + u;
+                    if(c.enRadius) rok[i] = nr >= c.N_min;
+                    if(!c.enStats)
+                    {   dm[i] = 0; continue; }
+                    int n = std::min<int>(c.meanK, ds.size());
+                    std::nth_element(ds.begin(), ds.begin()+n, ds.end());
+                    double sd = 0;
+                    for(int j=0;j<n;j++)
+                        sd += std::sqrt(ds[j]);
+                    // isolated : dropped, kept out of 
+                    //   the mean/std like invalid ones.
+                    dm[i] = (n>0) ? sd/n : -1;
+                }
+        });
+    }
     //---------------
     // Visualization
     //---------------
@@ -58,14 +108,20 @@ namespace{
     public:
         VisImp(const Cfg& c);
         auto raw(){ return p_pcl_vis_; }
+        pclu::PCloud::ConstPtr lod(const Points& ps, 
+                                   const string& sName);
+        void erase(const string& sName){ lods_.erase(sName); }
     protected:
         PclVis::Ptr p_pcl_vis_ = nullptr;
+        // decimated copy per cloud name, reused
+        map<string, pclu::PCloud::Ptr> lods_;
     };
     PclVis::Ptr getRaw(Points::Vis& v)
     { return (reinterpret_cast<VisImp&>(v)).raw(); }
     //-----
     VisImp::VisImp(const Cfg& c)
     {
+        cfg_ = c;
         auto cb = c.bk_color;
         auto p = PclVis::Ptr(new PclVis(c.sName));
         p->setBackgroundColor (cb.r/255.0, cb.g/255.0, cb.b/255.0);
@@ -73,6 +129,26 @@ namespace{
         p->initCameraParameters();
         p_pcl_vis_ = p;
     }
+    //---- cloud itself if within N_max, else
+    //   every k-th point into the reused buffer.
+    pclu::PCloud::ConstPtr VisImp::lod(const Points& ps,
+                                       const string& sName)
+    {
+        auto p = getRaw(ps);
+        size_t N = p->size();
+        size_t M = cfg_.N_max;
+        if(M==0 || N<=M) return p;
+        auto& pl = lods_[sName];
+        if(pl==nullptr) pl.reset(new pclu::PCloud);
+        pl->points.resize(M);
+        double k = double(N) / M;
+        for(size_t i=0;i<M;i++)
+            pl->points[i] = p->points[size_t(i*k)];
+        pl->width = M;
+        pl->height = 1;
+        pl->is_dense = p->is_dense;
+        return pl;
+    }
     
 }
     
@@ -88,16 +164,39 @@ void Points::Vis::add(const Points& pd,
 {
     auto p_vi = getRaw(*this);
     auto& vi = *p_vi;
-    auto p = getRaw(pd);
+    auto p = reinterpret_cast<VisImp&>(*this).lod(pd, sName);
     pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgb(p);
     vi.addPointCloud<pcl::PointXYZRGB> (p, rgb, sName);
     vi.setPointCloudRenderingProperties (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, pnt_sz, sName);
 }
+//---- buffers of the existing actor replaced,
+//   no remove/re-create.
+void Points::Vis::upd(const Points& pd, 
+                      const string& sName,
+                      float pnt_sz)
+{
+    auto p_vi = getRaw(*this);
+    auto& vi = *p_vi;
+    if(!vi.contains(sName))
+    {
+        add(pd, sName, pnt_sz);
+        return;
+    }
+    auto p = reinterpret_cast<VisImp&>(*this).lod(pd, sName);
+    pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgb(p);
+    vi.updatePointCloud<pcl::PointXYZRGB> (p, rgb, sName);
+}
+//----
+void Points::Vis::remove(const string& sName)
+{
+    getRaw(*this)->removePointCloud(sName);
+    reinterpret_cast<VisImp&>(*this).erase(sName);
+}
 //----
 bool Points::Vis::spin()
 {
     auto p = getRaw(*this);
-    p->spinOnce (100);
+    p->spinOnce (std::max(cfg_.spinMS, 1));
     return !(p->wasStopped());
 }
 //----
@@ -121,34 +220,178 @@ void Points::add(const Pnt& p)
     pc->height = 1;
 
 }
+//----
+void Points::clear()
+{
+    auto pc = getRaw(*this);
+    pc->points.clear();
+    pc->width = 0;
+    pc->height = 1;
+    pc->is_dense = true;
+}
+//----
+size_t Points::size()const
+{ return getRaw(*this)->size(); }
+//----
+Points::Pnt Points::get(size_t i)const
+{
+    auto& q = getRaw(*this)->points[i];
+    Pnt p;
+    p.p << q.x, q.y, q.z;
+    p.c = Color{q.r, q.g, q.b};
+    return p;
+}
 
 //---------------
 bool Points::load(const string& sf)
 {
     auto p = getRaw(*this);
-    if (pcl::io::loadPCDFile(sf, *p) == -1) 
+    bool bPly = FPath(sf).ext==".ply";
+    int r = bPly ? pcl::io::loadPLYFile(sf, *p) :
+                   pcl::io::loadPCDFile(sf, *p);
+    if(r<0)
     {
         log_ef(sf);
         return false;
     }
-    log_i("Load Point Cloud OK:'"+sf+"'");
+    log_i("Load Point Cloud OK:'"+sf+"', points:"+
+          to_string(p->size()));
     return true;
 }
 //----
-bool Points::save(const string& sf)const
+bool Points::save(const string& sf, int fmt)const
 {
     auto p = getRaw(*this);
-    int r = pcl::io::savePCDFileASCII(sf, *p);
-    if(r==-1)
+    if(fmt<0)
+        fmt = (FPath(sf).ext==".ply") ? 3 : 1;
+    int r = -1;
+    if(fmt==0) r = pcl::io::savePCDFileASCII(sf, *p);
+    else if(fmt==1) r = pcl::io::savePCDFileBinary(sf, *p);
+    else if(fmt==2) r = pcl::io::savePCDFileBinaryCompressed(sf, *p);
+    else if(fmt==3) r = pcl::io::savePLYFileBinary(sf, *p);
+    else log_e("Points: unknown file format:"+to_string(fmt));
+    if(r<0)
     {
         log_ef(sf);
         return false;
     }
 
-    log_i("Load Point Cloud OK:'"+sf+"'");
+    log_i("Save Point Cloud OK:'"+sf+"', points:"+
+          to_string(p->size()));
 
     return true;
 }
+//---------------
+// Writer
+//---------------
+bool Points::Writer::open(CStr& sf)
+{
+    close();
+    ofs_.open(sf, std::ios::binary | std::ios::trunc);
+    if(!ofs_.is_open())
+    {
+        log_ef(sf);
+        return false;
+    }
+    sf_ = sf;
+    bPly_ = FPath(sf).ext==".ply";
+    N_ = 0;
+    buf_.clear();
+    //---- count 0, patched on close()
+    string sh = header();
+    ofs_.write(sh.data(), sh.size());
+    return ofs_.good();
+}
+//---- fixed length, count zero padded so
+//   the header can be rewritten in place.
+string Points::Writer::header()const
+{
+    char sN[32];
+    snprintf(sN, sizeof(sN), "%0*zu", lc_.N_digits, N_);
+    stringstream s;
+    if(bPly_)
+    {
+        s << "ply\n"
+          << "format binary_little_endian 1.0\n"
+          << "element vertex " << sN << "\n"
+          << "property float x\n"
+          << "property float y\n"
+          << "property float z\n"
+          << "property uchar red\n"
+          << "property uchar green\n"
+          << "property uchar blue\n"
+          << "end_header\n";
+        return s.str();
+    }
+    s << "# .PCD v0.7 - Point Cloud Data file format\n"
+      << "VERSION 0.7\n"
+      << "FIELDS x y z rgb\n"
+      << "SIZE 4 4 4 4\n"
+      << "TYPE F F F F\n"
+      << "COUNT 1 1 1 1\n"
+      << "WIDTH " << sN << "\n"
+      << "HEIGHT 1\n"
+      << "VIEWPOINT 0 0 0 1 0 0 0\n"
+      << "POINTS " << sN << "\n"
+      << "DATA binary\n";
+    return s.str();
+}
+//---- PCD : x y z rgb(float bits),
+//   PLY : x y z r g b
+bool Points::Writer::add(const Pnt& p)
+{
+    if(!ofs_.is_open()) return false;
+    if(!p.p.allFinite()) return true; // grid holes
+    float v[3]{(float)p.p.x(), (float)p.p.y(), (float)p.p.z()};
+    buf_.append((const char*)v, sizeof(v));
+    auto& c = p.c;
+    if(bPly_)
+    {
+        char rgb[3]{(char)c.r, (char)c.g, (char)c.b};
+        buf_.append(rgb, sizeof(rgb));
+    }
+    else
+    {
+        float f = toPcl(p).rgb;
+        buf_.append((const char*)&f, sizeof(f));
+    }
+    N_++;
+    if(buf_.size() >= lc_.chunk)
+        return flush();
+    return true;
+}
+//----
+bool Points::Writer::add(const Points& ps)
+{
+    bool ok = true;
+    size_t N = ps.size();
+    for(size_t i=0;i<N && ok;i++)
+        ok = add(ps.get(i));
+    return ok;
+}
+//----
+bool Points::Writer::flush()
+{
+    ofs_.write(buf_.data(), buf_.size());
+    buf_.clear();
+    return ofs_.good();
+}
+//----
+bool Points::Writer::close()
+{
+    if(!ofs_.is_open()) return true;
+    bool ok = flush();
+    string sh = header();
+    ofs_.seekp(0);
+    ofs_.write(sh.data(), sh.size());
+    ok &= ofs_.good();
+    ofs_.close();
+    if(ok)
+        log_i("Points write:'"+sf_+"', points:"+to_string(N_));
+    else
+        log_ef(sf_);
+    return ok;
+}
 //----
 void Points::gen_cylinder()
 {
@@ -168,33 +411,162 @@ void Points::gen_cylinder()
 
 }
 //-------
-// Ref: slambook
+void Points::initGrid(int w, int h)
+{
+    auto p = getRaw(*this);
+    pclu::Pnt q;
+    q.x = q.y = q.z = std::numeric_limits<float>::quiet_NaN();
+    p->points.assign(size_t(w)*h, q);
+    p->width = w;
+    p->height = h;
+    p->is_dense = false;
+}
+//----
+void Points::set(int u, int v, const Pnt& p)
+{ (*getRaw(*this))(u, v) = toPcl(p); }
+//----
+bool Points::isGrid()const
+{ return getRaw(*this)->isOrganized(); }
+
+//-------
+// filter
+//-------
+// Per point mean neighbour distance (dm, -1 
+//   invalid or isolated) and radius test, 
+//   threshold over valid ones, then compacted
+//   in place.
+void Points::filter(const FilterCfg& c)
+{
+    auto p = getRaw(*this);
+    auto& pts = p->points;
+    int N = pts.size();
+    if(N==0) return;
+    bool bGrid = (c.mode==1);
+    if(bGrid && !isGrid())
+    {
+        log_i("Points: not organised, kd-tree filter used");
+        bGrid = false;
+    }
+    vector<float> dm(N, -1);
+    vector<uint8_t> rok(N, 1);
+    if(bGrid) filter_grid(*p, c, dm, rok);
+    else
+    {
+        pcl::KdTreeFLANN<pclu::Pnt> kd;
+        kd.setInputCloud(p);
+        parallel_for(N, [&](int i0, int i1){
+            vector<int> ids;
+            vector<float> d2s;
+            for(int i=i0;i<i1;i++)
+            {
+                auto& q = pts[i];
+                if(!pcl::isFinite(q)) continue;
+                if(c.enRadius)
+                    rok[i] = kd.radiusSearch(q, c.radius, ids, d2s,
+                                             c.N_min+1) > c.N_min;
+                if(!c.enStats)
+                {   dm[i] = 0; continue; }
+                // nearest is itself
+                int n = kd.nearestKSearch(q, c.meanK+1, ids, d2s);
+                double sd = 0;
+                for(int j=1;j<n;j++)
+                    sd += std::sqrt(d2s[j]);
+                dm[i] = (n>1) ? sd/(n-1) : 0;
+            }
+        });
+    }
+    //---- stats threshold
+    double th = std::numeric_limits<double>::max();
+    if(c.enStats)
+    {
+        double s=0, s2=0;
+        int n = 0;
+        for(auto d : dm)
+            if(d>=0) { s += d; s2 += d*d; n++; }
+        if(n>1)
+        {
+            double m = s/n;
+            double sd = std::sqrt(std::max(0.0, (s2 - s*m)/(n-1)));
+            th = m + c.devTh * sd;
+        }
+    }
+    //---- in place
+    size_t k = 0;
+    for(int i=0;i<N;i++)
+        if(dm[i]>=0 && dm[i]<=th && rok[i])
+            pts[k++] = pts[i];
+    pts.resize(k);
+    p->width = k;
+    p->height = 1;
+    p->is_dense = true;
+}
+//-------
 void Points::filter_stats(float meanK, float devTh)
 {
-    auto& d = reinterpret_cast<DataImp&>(*p_data_);
-    pclu::PCloud::Ptr p ( new pclu::PCloud );
-    pcl::StatisticalOutlierRemoval<pclu::Pnt> f;
-    f.setMeanK(meanK);
-    f.setStddevMulThresh(devTh);
-    f.setInputCloud(d.p_cloud_);
-    f.filter( *p );
-    d.p_cloud_ = p;
-    
+    FilterCfg c;
+    c.meanK = meanK;
+    c.devTh = devTh;
+    filter(c);
 }
 //-------
+// Centroid per voxel : keys in parallel, 
+//   sort, then each run reduced in parallel.
 void Points::filter_voxel(float reso)
 {
     auto& d = reinterpret_cast<DataImp&>(*p_data_);
-
-   // voxel filter 
-    pcl::VoxelGrid<pclu::Pnt> f; 
-    float r = reso;
-    f.setLeafSize( r, r, r );       // resolution 
+    auto& pts = d.p_cloud_->points;
+    int N = pts.size();
+    double s = 1.0/reso;
+    const uint64_t kNone = ~uint64_t(0);
+    vector<std::pair<uint64_t, int>> ks(N);
+    parallel_for(N, [&](int i0, int i1){
+        for(int i=i0;i<i1;i++)
+        {
+            auto& q = pts[i];
+            uint64_t k = kNone;
+            if(pcl::isFinite(q))
+            {
+                //---- 21 bits per axis
+                const int64_t o = int64_t(1) << 20;
+                const int64_t m = (int64_t(1) << 21) - 1;
+                k = 0;
+                for(auto f : {q.x, q.y, q.z})
+                    k = (k << 21) | uint64_t(
+                        ((int64_t)std::floor(f*s) + o) & m);
+            }
+            ks[i] = {k, i};
+        }
+    });
+    std::sort(ks.begin(), ks.end());
+    vector<int> r0;
+    int n = 0;
+    for(; n<N && ks[n].first!=kNone; n++)
+        if(n==0 || ks[n].first!=ks[n-1].first)
+            r0.push_back(n);
+    int M = r0.size();
+    r0.push_back(n);
+    //----
     pclu::PCloud::Ptr tmp ( new pclu::PCloud );
-    f.setInputCloud( d.p_cloud_ );
-    f.filter( *tmp );
+    tmp->points.resize(M);
+    parallel_for(M, [&](int j0, int j1){
+        for(int j=j0;j<j1;j++)
+        {
+            Eigen::Vector3f P(0,0,0);
+            int sc[3]{0,0,0};
+            int a = r0[j], b = r0[j+1];
+            for(int i=a;i<b;i++)
+            {
+                auto& q = pts[ks[i].second];
+                P += q.getVector3fMap();
+                sc[0] += q.r; sc[1] += q.g; sc[2] += q.b;
+            }
+            int c = b - a;
+            auto& o = tmp->points[j];
+            o.getVector3fMap() = P / c;
+            o.r = sc[0]/c; o.g = sc[1]/c; o.b = sc[2]/c;
+        }
+    });
+    tmp->width = M;
+    tmp->height = 1;
     tmp->swap( *d.p_cloud_ );
-    
 }
-
-
@@ -8,6 +8,8 @@ namespace{
     const struct{
         string sf_pnts_spar = "pnts_sparse.xyz";
         string sf_Tw = "Tw.txt";
+        string sf_pnts_map = "pnts_map.pcd";
+        string sf_surface = "surface.pcd";
     }lcfg_;
     //---- utils
     string gen_Tw3x4_line(const mat3& Rw, 
@@ -117,6 +119,35 @@ bool StereoVO::Cfg::load(const string& sf)
             fc.meanK = jfc["meanK"].asFloat();
             fc.devTh = jfc["devTh"].asFloat();
             fc.voxel_res = jfc["voxel_res"].asFloat();
+            if(jfc.isMember("mode"))
+            {
+                fc.mode = jfc["mode"].asInt();
+                fc.enRadius = jfc["enRadius"].asBool();
+                fc.radius = jfc["radius"].asFloat();
+                fc.N_min = jfc["N_min"].asInt();
+                fc.win = jfc["win"].asInt();
+            }
+            //---- optional
+            if(jpc.isMember("map"))
+            {
+                auto& jm = jpc["map"];
+                auto& m = pc.map;
+                m.en = jm["en"].asBool();
+                m.reso = jm["reso"].asFloat();
+                m.N_max = jm["N_max"].asInt();
+                m.age_max = jm["age_max"].asInt();
+            }
+        }
+
+        //---- tsdf, optional
+        if(js.isMember("tsdf"))
+        {
+            auto& jt = js["tsdf"];
+            tsdf.en = jt["en"].asBool();
+            tsdf.reso = jt["reso"].asFloat();
+            tsdf.trunc = jt["trunc"].asFloat();
+            tsdf.w_max = jt["w_max"].asFloat();
+            tsdf.z_max = jt["z_max"].asFloat();
         }
 
         //---- run
@@ -159,6 +190,20 @@ void StereoVO::Data::Wr::close()
     ofs_Tw.close(); 
 }
 
+//----
+void StereoVO::Data::close()
+{
+    wr.close();
+    if(p_tsdf!=nullptr)
+    {
+        log_i("Tsdf blocks:"+to_string(p_tsdf->N_blks()));
+        p_tsdf->toPoints()->save(lcfg_.sf_surface);
+    }
+    if(p_map==nullptr) return;
+    log_i("PointMap voxels:"+to_string(p_map->size())+
+          ", frames:"+to_string(p_map->N_frms()));
+    p_map->toPoints()->save(lcfg_.sf_pnts_map);
+}
 //------------
 bool StereoVO::Data::wrData()
 {
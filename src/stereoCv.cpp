@@ -13,6 +13,11 @@ namespace{
     const struct{
         int N_th_pnp = 4;
         float pnt_sz = 3;
+        // dense/map viewer, no wait on spin
+        size_t vis_N_max = 500000;
+        int vis_spinMS = 1;
+        // global map re-exported every N frames
+        int map_vis_N = 10;
     }lcfg_;
 
 }
@@ -51,7 +56,6 @@ bool StereoVOcv::FrmCv::at(int mi, MPnt& mpnt)const
 bool StereoVOcv::onImg(const Img& im1,  
                        const Img& im2)
 {
-    auto& camc = cfg_.camc;
     auto& vod = StereoVO::data_;
     auto& fi = vod.frmIdx;
     fi++;
@@ -59,11 +63,8 @@ bool StereoVOcv::onImg(const Img& im1,
     if(fi<=1 && cfg_.run.enWr) 
         vod.wr.open();
 
-    //---- img undistort
-    ocv::ImgCv imc1(im1);
-    ocv::ImgCv imc2(im2);
-    imc1.undistort(camc);
-    imc1.undistort(camc);
+    //---- imgs expected undistorted, e.g. 
+    //   StereoVideo with enUndist.
 
     bool ok = true;
     //---- do feature matching of L/R
@@ -98,6 +99,12 @@ bool StereoVOcv::onImg(const Img& im1,
     if(p_frmp!=nullptr)
         odometry(*p_frmp, *p_frm);
 
+    //---- fuse dense into map
+    if(cfg_.pntCloud.map.en)
+        updMap();
+    if(cfg_.tsdf.en)
+        updTsdf();
+
     //--- write data
     if(cfg_.run.enWr)
         vod.wrData();
@@ -405,6 +412,7 @@ bool StereoVOcv::run_quasi(const Img& im1,
     vector<cv::stereo::MatchQuasiDense> matches;
     stereo->getDenseMatches(matches);
     depth.p_imd_ = mkSp<ocv::ImgCv>(im_disp);
+    depth.disp_scl = 1;
     return ok;
 }
 
@@ -498,6 +506,8 @@ bool StereoVOcv::run_sgbm(const Img& im1,
 
     cv::Mat im_conf = p_fltr->getConfidenceMap();    
     depth.p_imd_ = mkSp<ocv::ImgCv>(imdf);
+    // values kept fixed point x16
+    depth.disp_scl = 1.0/16;
     return true;
 }
 //------
@@ -520,15 +530,22 @@ bool StereoVOcv::genDense(const Img& imL)
     //----
     auto p_imd = depth.p_imd_;
     if(p_imd==nullptr) return false;
-    cv::Mat imd = ImgCv(*p_imd).im_;
+    ConstImgView<float> vd(*p_imd);
+    if(!vd.val()) return false;
 
     //----
+    auto& fc = cfg_.pntCloud.filter;
     auto p_dense = mkSp<Points>();
     pntc.p_dense = p_dense;
-    for(int v = 0; v<imd.rows; v++)
-        for(int u = 0; u<imd.cols; u++)
+    //---- grid filter keeps pixel layout
+    bool bGrid = fc.en && fc.mode==1;
+    if(bGrid) p_dense->initGrid(vd.w(), vd.h());
+    for(int v = 0; v<vd.h(); v++)
+    {
+        auto pd = vd.row(v);
+        for(int u = 0; u<vd.w(); u++)
         {
-            double d = imd.at<float>(v,u);
+            double d = pd[u];
             
             double z = d/b;
             double x= (u-L.cx)/L.fx;
@@ -539,20 +556,94 @@ bool StereoVOcv::genDense(const Img& imL)
                 continue;
             //else std::cout << z <<" ";
             vec3 P; P << x,y,z;
-            Color c;
-            imL.get(Px(x,y), c);
-            c = {255,255,255,255}; // debug
-            p_dense->add({P,c});
+            Color c{255,255,255,255}; // debug
+            if(bGrid) p_dense->set(u, v, {P,c});
+            else p_dense->add({P,c});
         }
+    }
     
     //---- filter
-    auto& fc = cfg_.pntCloud.filter;
     if(fc.en)
-        p_dense->filter_stats(fc.meanK, fc.devTh);
+    {
+        Points::FilterCfg c;
+        c.mode = fc.mode;
+        c.meanK = fc.meanK;
+        c.devTh = fc.devTh;
+        c.enRadius = fc.enRadius;
+        c.radius = fc.radius;
+        c.N_min = fc.N_min;
+        c.win = fc.win;
+        p_dense->filter(c);
+    }
 
     return true;
 }
 
+//------
+void StereoVOcv::updMap()
+{
+    auto p_frmo = StereoVO::data_.p_frm;
+    if(p_frmo==nullptr) return;
+    auto p_dense = p_frmo->depth.pntc.p_dense;
+    if(p_dense==nullptr) return;
+    auto& p_map = StereoVO::data_.p_map;
+    if(p_map==nullptr)
+    {
+        auto& mc = cfg_.pntCloud.map;
+        PointMap::Cfg c;
+        c.reso = mc.reso;
+        c.N_max = mc.N_max;
+        c.age_max = mc.age_max;
+        p_map = PointMap::create(c);
+        if(p_map==nullptr) return;
+    }
+    auto& odom = StereoVO::data_.odom;
+    p_map->add(*p_dense, odom.Rw, odom.tw);
+}
+
+
+//------
+// depth z = fx*b/(d*disp_scl) from the disparity
+void StereoVOcv::updTsdf()
+{
+    auto p_frmo = StereoVO::data_.p_frm;
+    if(p_frmo==nullptr) return;
+    auto p_imd = p_frmo->depth.p_imd_;
+    if(p_imd==nullptr) return;
+    auto& camc = cfg_.camc;
+    CamCfg::Lense L;
+    if(!camc.toLense(L)) return;
+    auto& tc = cfg_.tsdf;
+    auto& p_tsdf = StereoVO::data_.p_tsdf;
+    if(p_tsdf==nullptr)
+    {
+        Tsdf::Cfg c;
+        c.reso = tc.reso;
+        c.trunc = tc.trunc;
+        c.w_max = tc.w_max;
+        c.z_max = tc.z_max;
+        p_tsdf = Tsdf::create(c);
+        if(p_tsdf==nullptr) return;
+    }
+    ConstImgView<float> vd(*p_imd);
+    if(!vd.val()) return;
+    float ds = p_frmo->depth.disp_scl;
+    float k = L.fx * cfg_.baseline;
+    cv::Mat imz;
+    imz.allocator = poolAlloc();
+    imz.create(vd.h(), vd.w(), CV_32F);
+    parallel_for(vd.h(), [&](int y0, int y1){
+        for(int y=y0;y<y1;y++)
+        {
+            auto pd = vd.row(y);
+            auto pz = imz.ptr<float>(y);
+            for(int x=0;x<vd.w();x++)
+                pz[x] = (pd[x] > 0) ? k / (pd[x]*ds) : 0;
+        }
+    });
+    auto& odom = StereoVO::data_.odom;
+    p_tsdf->integrate(ImgCv(imz), camc, odom.Rw, odom.tw);
+}
 
 //-----
 void StereoVOcv::show()
@@ -574,18 +665,39 @@ void StereoVOcv::show()
         imshow("Disparity", imdv);
     }
 
-    //---- show points dense
+    //---- show global map if any, else
+    //   points dense, updated in place.
     auto& pvis = StereoVO::data_.pntVis;
     if(pvis.p_vis_dense==nullptr)
-        pvis.p_vis_dense = Points::Vis::create();
+    {
+        Points::Vis::Cfg vc;
+        vc.N_max = lcfg_.vis_N_max;
+        vc.spinMS = lcfg_.vis_spinMS;
+        pvis.p_vis_dense = Points::Vis::create(vc);
+    }
     auto& vden = *pvis.p_vis_dense;
-    vden.clear();
-    auto p_dense = pntc.p_dense;
-    if(p_dense!=nullptr)
+    auto p_map = StereoVO::data_.p_map;
+    Sp<Points> p_dense = pntc.p_dense;
+    if(p_map!=nullptr)
     {
-        vden.add(*p_dense, "dense", lcfg_.pnt_sz);
-        vden.spin();
+        //---- full export is O(voxels), so only
+        //   every map_vis_N frames, same buffer.
+        p_dense = nullptr;
+        if(pvis.p_map==nullptr)
+        {
+            pvis.p_map = mkSp<Points>();
+            pvis.N_mapAge = lcfg_.map_vis_N;
+        }
+        if(pvis.N_mapAge++ >= lcfg_.map_vis_N)
+        {
+            p_map->toPoints(*pvis.p_map);
+            p_dense = pvis.p_map;
+            pvis.N_mapAge = 1;
+        }
     }
+    if(p_dense!=nullptr)
+        vden.upd(*p_dense, "dense", lcfg_.pnt_sz);
+    vden.spin();
     //---- show depth of point cloud
     
 
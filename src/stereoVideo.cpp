@@ -0,0 +1,107 @@
+#include "vsn/vsnLibCv.h"
+
+using namespace vsn;
+using namespace ocv;
+using namespace ut;
+
+namespace{
+    //---- per side undistortion, maps built
+    //   once per view size.
+    struct Undist{
+        cv::Size sz{0,0};
+        cv::Mat m1, m2;
+        void init(const CamCfg& cc, const cv::Size& s)
+        {
+            if(s==sz) return;
+            sz = s;
+            cv::Mat Kc, Dc;
+            eigen2cv(cc.K, Kc);
+            eigen2cv(cc.D.V(), Dc);
+            cv::initUndistortRectifyMap(Kc, Dc, cv::Mat(), Kc,
+                                        sz, CV_16SC2, m1, m2);
+        }
+        //---- same as ImgCv::undistort(), pooled
+        cv::Mat run(const cv::Mat& im)const
+        {
+            cv::Mat imo;
+            imo.allocator = poolAlloc();
+            cv::remap(im, imo, m1, m2, cv::INTER_LINEAR,
+                      cv::BORDER_CONSTANT);
+            return imo;
+        }
+    };
+    //------------
+    // StereoVideoCv
+    //------------
+    class StereoVideoCv : public StereoVideo{
+    public:
+        StereoVideoCv(Sp<Video> p_vd, const Cfg& c):
+            p_vd_(p_vd), cfg_(c){}
+        virtual bool read(Sp<Img>& pL, Sp<Img>& pR)override;
+        virtual Sp<Video> video()const override{ return p_vd_; }
+    protected:
+        Sp<Video> p_vd_ = nullptr;
+        Cfg cfg_;
+        Undist uds_[2];
+        bool view(const cv::Mat& im, const ut::Rect& r,
+                  int k, Sp<Img>& p);
+    };
+    //---- ROI of r (zero size: half k),
+    //   undistorted if enabled.
+    bool StereoVideoCv::view(const cv::Mat& im, const ut::Rect& r,
+                             int k, Sp<Img>& p)
+    {
+        cv::Rect rc(im.cols/2*k, 0, im.cols/2, im.rows);
+        if(r.sz.w>0 && r.sz.h>0)
+        {
+            Px p0 = r.p0();
+            rc = cv::Rect(p0.x, p0.y, r.sz.w, r.sz.h);
+        }
+        if((rc & cv::Rect(0, 0, im.cols, im.rows)) != rc)
+        {
+            log_e("StereoVideo: view out of frame:"+r.str());
+            return false;
+        }
+        cv::Mat imv = im(rc);
+        if(cfg_.enUndist)
+        {
+            auto& u = uds_[k];
+            u.init(k==0 ? cfg_.camL : cfg_.camR, imv.size());
+            imv = u.run(imv);
+        }
+        auto pc = mkSp<ImgCv>(imv);
+        p = pc;
+        return true;
+    }
+    //----
+    bool StereoVideoCv::read(Sp<Img>& pL, Sp<Img>& pR)
+    {
+        pL = pR = nullptr;
+        auto p = p_vd_->read();
+        if(p==nullptr) return false;
+        cv::Mat im = ImgCv(*p).raw();
+        bool ok = view(im, cfg_.rL, 0, pL) &&
+                  view(im, cfg_.rR, 1, pR);
+        if(!ok)
+        {   pL = pR = nullptr; return false; }
+        for(auto pi : {pL, pR})
+        {
+            pi->setClrSpc(p->clrSpc());
+            pi->frm = p->frm;
+        }
+        return true;
+    }
+}
+
+//----
+Sp<StereoVideo> StereoVideo::create(Sp<Video> p_vd, const Cfg& c)
+{
+    if(p_vd==nullptr) return nullptr;
+    return mkSp<StereoVideoCv>(p_vd, c);
+}
+//----
+Sp<StereoVideo> StereoVideo::open(CStr& s, const Cfg& c,
+                                  const Video::Cfg& vc)
+{
+    return create(Video::open(s, vc), c);
+}
@@ -0,0 +1,214 @@
+#include "vsn/vsnLib.h"
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace vsn;
+using namespace ut;
+
+namespace{
+    const int B = 8; // block voxels per axis
+    const int B3 = B*B*B;
+    //---- block coords
+    struct Idx{
+        int x=0, y=0, z=0;
+        bool operator == (const Idx& i)const
+        { return x==i.x && y==i.y && z==i.z; }
+    };
+    struct IdxHash{
+        size_t operator()(const Idx& i)const
+        { return (size_t(i.x)*73856093) ^ 
+                 (size_t(i.y)*19349663) ^ 
+                 (size_t(i.z)*83492791); }
+    };
+    //---- tsdf normalised to [-1,1] by trunc
+    struct Blk{
+        float D[B3];
+        float W[B3];
+        Blk(){ std::fill(D, D+B3, 1.f); 
+               std::fill(W, W+B3, 0.f); }
+    };
+    inline int vi(int x, int y, int z){ return (z*B + y)*B + x; }
+
+    //------------
+    // TsdfImp
+    //------------
+    class TsdfImp : public Tsdf{
+    public:
+        TsdfImp(const Cfg& c):cfg_(c){}
+        virtual bool integrate(const Img& imz, const CamCfg& cc,
+                               const mat3& Rw, const vec3& tw)override;
+        virtual Sp<Points> toPoints(float w_min)const override;
+        virtual size_t N_blks()const override{ return blks_.size(); }
+        virtual void clear()override{ blks_.clear(); }
+    protected:
+        Cfg cfg_;
+        std::unordered_map<Idx, Blk, IdxHash> blks_;
+        Idx blkIdx(const vec3& P)const
+        {   double s = 1.0 / (cfg_.reso * B);
+            return { (int)std::floor(P.x()*s), 
+                     (int)std::floor(P.y()*s),
+                     (int)std::floor(P.z()*s) }; }
+        // voxel centre, world
+        vec3 voxP(const Idx& b, int x, int y, int z)const
+        {   double r = cfg_.reso;
+            vec3 P; P << (b.x*B + x + 0.5)*r,
+                         (b.y*B + y + 0.5)*r,
+                         (b.z*B + z + 0.5)*r;
+            return P; }
+        float tsdfAt(const Idx& b, int x, int y, int z,
+                     float w_min, bool& ok)const;
+    };
+    //---- 1) blocks along each ray within trunc,
+    //   2) frustum check by block centre,
+    //   3) projective tsdf per voxel, parallel.
+    bool TsdfImp::integrate(const Img& imz, const CamCfg& cc,
+                            const mat3& Rw, const vec3& tw)
+    {
+        auto& c = cfg_;
+        ConstImgView<float> vz(imz);
+        if(!vz.val()) return false;
+        CamCfg::Lense L;
+        if(!cc.toLense(L)) return false;
+        int W = vz.w(), H = vz.h();
+        int st = std::max(c.px_step, 1);
+        double bs = c.reso * B;
+        //---- 1) touched blocks, per band then merged
+        int N_bd = (H + st - 1)/st;
+        vector<vector<Idx>> bids(N_bd);
+        parallel_for(N_bd, [&](int i0, int i1){
+            for(int i=i0;i<i1;i++)
+            {
+                int v = i*st;
+                auto pz = vz.row(v);
+                auto& ids = bids[i];
+                for(int u=0;u<W;u+=st)
+                {
+                    float z = pz[u];
+                    if(!(z>=c.z_min && z<=c.z_max)) continue;
+                    vec3 r; r << (u-L.cx)/L.fx, (v-L.cy)/L.fy, 1;
+                    for(double d=-c.trunc; d<=c.trunc+1e-6; d+=bs*0.5)
+                    {
+                        vec3 P = Rw*(r*(z+d)) + tw;
+                        ids.push_back(blkIdx(P));
+                    }
+                }
+            }
+        });
+        std::unordered_set<Idx, IdxHash> vis;
+        for(auto& ids : bids)
+            vis.insert(ids.begin(), ids.end());
+        //---- 2) allocate, keep those in frustum
+        mat3 Rc = Rw.transpose();
+        vector<std::pair<Idx, Blk*>> bs_in;
+        for(auto& b : vis)
+        {
+            vec3 Pc = Rc*(voxP(b, B/2, B/2, B/2) - tw);
+            double z = Pc.z();
+            if(z <= 0) continue;
+            double u = L.fx*Pc.x()/z + L.cx;
+            double v = L.fy*Pc.y()/z + L.cy;
+            double m = L.fx*bs/z; // block radius in px
+            if(u < -m || u > W+m || v < -m || v > H+m)
+                continue;
+            bs_in.push_back({b, &blks_[b]});
+        }
+        //---- 3) own block per task, no locks
+        parallel_for(bs_in.size(), [&](int i0, int i1){
+            for(int i=i0;i<i1;i++)
+            {
+                auto& bi = bs_in[i].first;
+                auto& blk = *bs_in[i].second;
+                for(int z=0;z<B;z++)
+                for(int y=0;y<B;y++)
+                for(int x=0;x<B;x++)
+                {
+                    vec3 Pc = Rc*(voxP(bi, x, y, z) - tw);
+                    double zc = Pc.z();
+                    if(zc <= 0) continue;
+                    int u = (int)std::lround(L.fx*Pc.x()/zc + L.cx);
+                    int v = (int)std::lround(L.fy*Pc.y()/zc + L.cy);
+                    if(u<0 || u>=W || v<0 || v>=H) continue;
+                    float zd = vz.at(u, v);
+                    if(!(zd>=c.z_min && zd<=c.z_max)) continue;
+                    float sdf = zd - zc;
+                    if(sdf < -c.trunc) continue; // occluded
+                    float t = std::min(1.f, sdf / c.trunc);
+                    int k = vi(x, y, z);
+                    float& w = blk.W[k];
+                    blk.D[k] = (blk.D[k]*w + t) / (w + 1);
+                    w = std::min(w + 1, c.w_max);
+                }
+            }
+        });
+        return true;
+    }
+    //---- voxel across block borders
+    float TsdfImp::tsdfAt(const Idx& b, int x, int y, int z,
+                          float w_min, bool& ok)const
+    {
+        Idx bn = b;
+        if(x>=B){ bn.x++; x-=B; }
+        if(y>=B){ bn.y++; y-=B; }
+        if(z>=B){ bn.z++; z-=B; }
+        ok = false;
+        auto it = blks_.find(bn);
+        if(it==blks_.end()) return 1;
+        int k = vi(x, y, z);
+        auto& blk = it->second;
+        ok = blk.W[k] >= w_min;
+        return blk.D[k];
+    }
+    //---- sign change to +x/+y/+z neighbour,
+    //   point linear interpolated.
+    Sp<Points> TsdfImp::toPoints(float w_min)const
+    {
+        vector<const std::pair<const Idx, Blk>*> bv;
+        for(auto& b : blks_) bv.push_back(&b);
+        vector<vector<vec3>> Pss(bv.size());
+        parallel_for(bv.size(), [&](int i0, int i1){
+            for(int i=i0;i<i1;i++)
+            {
+                auto& bi = bv[i]->first;
+                auto& blk = bv[i]->second;
+                auto& Ps = Pss[i];
+                for(int z=0;z<B;z++)
+                for(int y=0;y<B;y++)
+                for(int x=0;x<B;x++)
+                {
+                    int k = vi(x, y, z);
+                    float d0 = blk.D[k];
+                    if(blk.W[k] < w_min || d0 >= 1) continue;
+                    vec3 P0 = voxP(bi, x, y, z);
+                    int ds[3][3]{{1,0,0},{0,1,0},{0,0,1}};
+                    for(auto& o : ds)
+                    {
+                        bool ok = false;
+                        float d1 = tsdfAt(bi, x+o[0], y+o[1], z+o[2],
+                                          w_min, ok);
+                        // truncated side is no surface
+                        if(!ok || d1 >= 1 || (d0>0)==(d1>0))
+                            continue;
+                        vec3 P1 = voxP(bi, x+o[0], y+o[1], z+o[2]);
+                        Ps.push_back(P0 + (P1-P0)*(d0/(d0-d1)));
+                    }
+                }
+            }
+        });
+        auto p = mkSp<Points>();
+        Color cl{200,200,200};
+        for(auto& Ps : Pss)
+            for(auto& P : Ps)
+                p->add({P, cl});
+        return p;
+    }
+}
+//----
+Sp<Tsdf> Tsdf::create(const Cfg& c)
+{
+    if(c.reso<=0 || c.trunc<=0)
+    {
+        log_e("Tsdf: reso and trunc must be > 0");
+        return nullptr;
+    }
+    return mkSp<TsdfImp>(c);
+}
@@ -8,11 +8,28 @@
 
 #include "vsn/vsnLibCv.h"
 
+#include <filesystem>
+
 using namespace ocv;
 
+namespace{
+    struct LCfg{
+        // forward skip by grab() up to this,
+        //   backend seek beyond.
+        int grab_max = 300;
+        int seek_tries = 4;
+        int idx_log_N = 10000;
+    }; LCfg lc_;
+    //---- '.vidx' sidecar : magic, file size,
+    //   mtime (ns), N, then N pts (ms) as double.
+    //   Rebuilt if size or mtime differ.
+    const char sIdxMagic_[8]{'V','S','N','V','I','D','X',2};
+}
+
 //--------
 VideoCv::VideoCv(CStr& s)
 {
+    sf_ = s;
     cap_.open(s, CAP_FFMPEG);
     bool ok = cap_.isOpened();
     if(!ok) return;
@@ -20,11 +37,29 @@ VideoCv::VideoCv(CStr& s)
     cfg_.sz.w = cap_.get(CAP_PROP_FRAME_WIDTH);
     cfg_.sz.h = cap_.get(CAP_PROP_FRAME_HEIGHT);
     cfg_.fps = cap_.get(CAP_PROP_FPS);
+    t0_ = std::chrono::steady_clock::now();
 }
 //--------
-Sp<Video> Video::open(CStr& s)
+Sp<Video> Video::open(CStr& s, const Cfg& cfg)
 {
-    
+    //---- raw frame container
+    if(FPath(s).ext==".vfrm")
+    {
+        auto p = FrmPack::open(s);
+        if(p==nullptr) return nullptr;
+        //---- stride by index in readLR(), pack
+        //   has no fps and frames are mapped, 
+        //   nothing to decode ahead or reduce.
+        auto& r = cfg.rd;
+        p->cfg_.rd.stride = std::max(r.stride, 1);
+        if(r.fps>0)
+            log_e("FrmPack: rd.fps unsupported, use rd.stride");
+        if(r.dec>1)
+            log_e("FrmPack: rd.dec unsupported, full size read");
+        if(cfg.async.en)
+            log_e("FrmPack: async unsupported, read is mapped");
+        return p;
+    }
     auto p = mkSp<VideoCv>(s);
     if(!p->isOpen()) 
     {
@@ -34,33 +69,207 @@ Sp<Video> Video::open(CStr& s)
     stringstream ss;
     ss << "Open OK video:" << s << endl;
     auto& c = p->cfg_;
+    c.async = cfg.async;
+    c.rd = cfg.rd;
+    p->initRd();
     ss << "  size:" << c.sz.w << "x" << c.sz.h << ", ";
-    ss << "fps:" << c.fps << endl;
+    ss << "fps:" << c.fps;
+    if(c.rd.stride>1) ss << ", stride:" << c.rd.stride;
+    ss << endl;
 
     log_i(ss.str());
+    if(c.async.en)
+        p->startAsync();
     return p;
 }
+//---- stride from target fps, reduced size by
+//   capture props, else resized after decode.
+void VideoCv::initRd()
+{
+    auto& r = cfg_.rd;
+    if(r.fps>0)
+    {
+        if(cfg_.fps>0)
+            r.stride = (int)std::lround(cfg_.fps / r.fps);
+        else log_i("Video: source fps unknown, target fps ignored");
+    }
+    r.stride = std::max(r.stride, 1);
+    nSkip_ = 0;
+    bResize_ = false;
+    if(r.dec<=1) return;
+    int w = cfg_.sz.w / r.dec;
+    int h = cfg_.sz.h / r.dec;
+    //---- live cameras mostly take it, file
+    //   decoders (FFmpeg) ignore it.
+    cap_.set(CAP_PROP_FRAME_WIDTH, w);
+    cap_.set(CAP_PROP_FRAME_HEIGHT, h);
+    bResize_ = (int)cap_.get(CAP_PROP_FRAME_WIDTH) != w ||
+               (int)cap_.get(CAP_PROP_FRAME_HEIGHT)!= h;
+    if(bResize_)
+        log_i("Video: backend has no reduced decode, "
+              "resized after decode");
+    cfg_.sz = {w, h};
+}
 //--------
-Sp<Img> VideoCv::read()
+Sp<Img> VideoCv::readCap()
 {
+    //---- decimation, grab() only
+    for(;nSkip_>0;nSkip_--)
+    {
+        if(!bGrabbed_ && !cap_.grab())
+            return nullptr;
+        bGrabbed_ = false;
+        pos_++;
+    }
+    nSkip_ = cfg_.rd.stride - 1;
+    //----
     Mat im;
-    cap_.read(im);
+    im.allocator = poolAlloc();
+    if(bGrabbed_) cap_.retrieve(im);
+    else cap_.read(im);
+    bGrabbed_ = false;
     if(im.empty())
         return nullptr;
+    if(bResize_)
+    {
+        Mat imr;
+        imr.allocator = poolAlloc();
+        auto& sz = cfg_.sz;
+        cv::resize(im, imr, Size(sz.w, sz.h), 0, 0, INTER_AREA);
+        im = imr;
+    }
     auto p = mkSp<ImgCv>(im);
+    p->setClrSpc(Img::ClrSpc::BGR);
+    //---- frame info, wall clock if source
+    //   has no pts (live cameras).
+    auto& f = p->frm;
+    f.seq = seq_++;
+    f.idx = pos_++;
+    double ms = cap_.get(CAP_PROP_POS_MSEC);
+    if(ms > 0) f.t = ms * 1e-3;
+    else f.t = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0_).count();
     return p;
 }
+//--------
+Sp<Img> VideoCv::read()
+{
+    if(!ring_.thd.joinable())
+        return readCap();
+    auto& r = ring_;
+    std::unique_lock<std::mutex> lk(r.mtx);
+    r.cv.wait(lk, [&](){ 
+        return !r.frms.empty() || r.bEnd || r.bStop; });
+    if(r.frms.empty())
+        return nullptr;
+    auto p = r.frms.front();
+    r.frms.pop_front();
+    lk.unlock();
+    r.cv.notify_all();
+    return p;
+}
+//--------
+bool VideoCv::startAsync()
+{
+    if(ring_.thd.joinable()) return true;
+    if(!cap_.isOpened()) return false;
+    auto& a = cfg_.async;
+    a.N_ring = std::max(a.N_ring, 1);
+    ring_.bStop = ring_.bEnd = false;
+    ring_.thd = std::thread([this](){ decodeLoop(); });
+    log_i("Video async read, ring:"+to_string(a.N_ring)+
+          ", policy:"+to_string(a.policy));
+    return true;
+}
+//---- decoder thread
+void VideoCv::decodeLoop()
+{
+    auto& r = ring_;
+    auto& a = cfg_.async;
+    while(1)
+    {
+        auto p = readCap();
+        std::unique_lock<std::mutex> lk(r.mtx);
+        if(p==nullptr || r.bStop)
+        {
+            r.bEnd = true;
+            lk.unlock();
+            r.cv.notify_all();
+            return;
+        }
+        //---- full ring by policy
+        if(a.policy==0)
+            r.cv.wait(lk, [&](){ return r.bStop ||
+                (int)r.frms.size() < a.N_ring; });
+        else if(a.policy==2)
+            r.frms.clear();
+        else while((int)r.frms.size() >= a.N_ring)
+            r.frms.pop_front();
+        if(r.bStop) return;
+        r.frms.push_back(p);
+        lk.unlock();
+        r.cv.notify_all();
+    }
+}
+//--------
+void VideoCv::stopAsync()
+{
+    auto& r = ring_;
+    if(!r.thd.joinable()) return;
+    {
+        std::unique_lock<std::mutex> lk(r.mtx);
+        r.bStop = true;
+    }
+    r.cv.notify_all();
+    r.thd.join();
+    r.frms.clear();
+}
 //-----        
 bool VideoCv::createWr(CStr& sf)
 {
     Sz sz = cfg_.sz;
-    p_vwr = mkSp<VideoWriter>(sf, 
-        cv::VideoWriter::fourcc('M','J','P','G'), 
-    //  cv::VideoWriter::fourcc('H','2','6','4'), 
-    //  cv::VideoWriter::fourcc('m','p','4','v'), 
-    //  cv::VideoWriter::fourcc('P','I','M','1'), 
-        cfg_.fps, Size(sz.w,sz.h));
-    return p_vwr->isOpened();
+    auto& w = cfg_.wr;
+    //---- e.g. MJPG, FFV1, H264, mp4v, PIM1
+    int fcc = 0; // raw
+    if(w.codec!="raw")
+    {
+        if(w.codec.size()!=4)
+        {
+            log_e("Video: codec must be fourcc or 'raw':"+w.codec);
+            return false;
+        }
+        auto& c = w.codec;
+        fcc = cv::VideoWriter::fourcc(c[0], c[1], c[2], c[3]);
+    }
+    p_vwr = mkSp<VideoWriter>(sf, fcc,
+        cfg_.fps, Size(sz.w,sz.h), w.color);
+    if(!p_vwr->isOpened())
+        return false;
+    if(w.async)
+    {
+        wrq_.bStop = false;
+        wrq_.thd = std::thread([this](){ encodeLoop(); });
+    }
+    return true;
+}
+//---- encoder thread, drains queue on stop
+void VideoCv::encodeLoop()
+{
+    auto& q = wrq_;
+    while(1)
+    {
+        cv::Mat im;
+        {
+            std::unique_lock<std::mutex> lk(q.mtx);
+            q.cv.wait(lk, [&](){ 
+                return q.bStop || !q.frms.empty(); });
+            if(q.frms.empty()) return; // stopped
+            im = q.frms.front();
+            q.frms.pop_front();
+        }
+        q.cv.notify_all();
+        p_vwr->write(im);
+    }
 }
 
 //-----  static
@@ -79,21 +288,194 @@ Sp<Video> Video::create(CStr& sf, const Cfg& cfg)
 //----- 
 bool VideoCv::write(const Img& im)
 { 
-    auto& imc = reinterpret_cast<const ImgCv&>(im);
     if(p_vwr==nullptr)
         return false;
     if(!p_vwr->isOpened())
         return false;
-    //p_vwr->write(imc.im_);
-    auto& vw = *p_vwr;
-    Mat imw; imc.im_.copyTo(imw);
-    vw.write(imw);
+    //---- writer channels by Wr::color, shares
+    //   pixels if already there, else converted
+    //   (memoised on im).
+    auto c = cfg_.wr.color ? Img::ClrSpc::BGR : 
+                             Img::ClrSpc::GRAY;
+    Mat imw = ImgCv(*im.as(c)).raw();
+    auto& q = wrq_;
+    if(!q.thd.joinable())
+    {
+        p_vwr->write(imw);
+        return true;
+    }
+    //---- bounded queue, block when full
+    {
+        std::unique_lock<std::mutex> lk(q.mtx);
+        int N = std::max(cfg_.wr.N_queue, 1);
+        q.cv.wait(lk, [&](){ 
+            return (int)q.frms.size() < N; });
+        q.frms.push_back(imw);
+    }
+    q.cv.notify_all();
     return true;
 }
 //-----
 void VideoCv::close()
 {
-   // if(p_vwr==nullptr)
-     //   p_vwr->release();
+    stopAsync();
+    //---- flush encode queue
+    auto& q = wrq_;
+    if(q.thd.joinable())
+    {
+        {
+            std::unique_lock<std::mutex> lk(q.mtx);
+            q.bStop = true;
+        }
+        q.cv.notify_all();
+        q.thd.join();
+    }
+    if(p_vwr!=nullptr)
+    {
+        p_vwr->release();
+        p_vwr = nullptr;
+    }
+}
+//--------
+// seek
+//--------
+// Short forward skips grab() without retrieve,
+//   no index needed. Backward and longer ones 
+//   use the backend seek (keyframe before, 
+//   decode forward), then the landed frame is 
+//   identified by its pts in the index, so the
+//   frame number stays exact for variable frame
+//   rate too. The index is built on first need.
+bool VideoCv::seek(int64_t n)
+{
+    if(!cap_.isOpened())
+        return false;
+    if(n<0)
+    {
+        log_e("Video: seek out of range:"+to_string(n));
+        return false;
+    }
+    bool bAsync = ring_.thd.joinable();
+    stopAsync();
+    //---- last grabbed frame
+    int64_t cur = bGrabbed_ ? pos_ : pos_-1;
+    bool ok = (n > cur || (n==cur && bGrabbed_)) && 
+              (n - cur <= lc_.grab_max);
+    if(!ok && !loadIdx())
+        return false;
+    int64_t N = N_frms();
+    if(N>=0 && n>=N)
+    {
+        log_e("Video: seek out of range:"+to_string(n)+
+              ", frames:"+to_string(N));
+        return false;
+    }
+    if(!ok)
+    {
+        int64_t s = n;
+        for(int k=0; k<lc_.seek_tries && !ok; k++)
+        {
+            cap_.set(CAP_PROP_POS_FRAMES, (double)s);
+            if(!cap_.grab()) break;
+            cur = frmAt(cap_.get(CAP_PROP_POS_MSEC));
+            if(cur <= n) ok = true;
+            else s -= (cur - n) + k*lc_.grab_max/4 + 1;
+            s = std::max<int64_t>(s, 0);
+        }
+    }
+    //---- grab forward to n
+    while(ok && cur < n)
+    {
+        ok = cap_.grab();
+        cur++;
+    }
+    if(!ok)
+    {
+        log_e("Video: seek failed:"+to_string(n));
+        bGrabbed_ = false;
+        return false;
+    }
+    pos_ = n;
+    bGrabbed_ = true;
+    nSkip_ = 0; // n itself is returned
+    if(bAsync) startAsync();
+    return true;
+}
+//---- nearest frame of pts
+int64_t VideoCv::frmAt(double ms)const
+{
+    auto it = std::lower_bound(pts_.begin(), pts_.end(), ms);
+    int64_t i = it - pts_.begin();
+    if(i>=(int64_t)pts_.size()) 
+        return pts_.size()-1;
+    if(i>0 && (ms - pts_[i-1]) < (pts_[i] - ms))
+        i--;
+    return i;
+}
+//---- load sidecar, or scan file once with
+//   grab() and write it.
+bool VideoCv::loadIdx()
+{
+    if(!pts_.empty()) return true;
+    namespace fs = std::filesystem;
+    string sfi = sf_ + ".vidx";
+    std::error_code ec;
+    uint64_t fsz = fs::file_size(sf_, ec);
+    int64_t mt = 0;
+    if(!ec)
+        mt = fs::last_write_time(sf_, ec)
+                .time_since_epoch().count();
+    if(ec)
+    {
+        log_e("Video: seek needs a file source");
+        return false;
+    }
+    //---- cached, same size and mtime
+    {
+        std::ifstream ifs(sfi, std::ios::binary);
+        char mg[8]{};
+        uint64_t sz=0, N=0;
+        int64_t t=0;
+        ifs.read(mg, 8);
+        ifs.read((char*)&sz, sizeof(sz));
+        ifs.read((char*)&t, sizeof(t));
+        ifs.read((char*)&N, sizeof(N));
+        std::error_code eci;
+        uint64_t isz = fs::file_size(sfi, eci);
+        size_t hsz = 8 + sizeof(sz) + sizeof(t) + sizeof(N);
+        if(ifs.good() && !eci && sz==fsz && t==mt &&
+           memcmp(mg, sIdxMagic_, 8)==0 &&
+           isz >= hsz && N == (isz - hsz)/sizeof(double))
+        {
+            pts_.resize(N);
+            ifs.read((char*)pts_.data(), N*sizeof(double));
+            if(ifs.good()) return true;
+            pts_.clear();
+        }
+    }
+    //---- build
+    log_i("Video: building frame index '"+sfi+"'...");
+    cv::VideoCapture cap(sf_, CAP_FFMPEG);
+    while(cap.grab())
+    {
+        pts_.push_back(cap.get(CAP_PROP_POS_MSEC));
+        if(pts_.size() % lc_.idx_log_N == 0)
+            log_i("  indexed frames:"+to_string(pts_.size()));
+    }
+    if(pts_.empty())
+    {
+        log_e("Video: no frames to index");
+        return false;
+    }
+    std::ofstream ofs(sfi, std::ios::binary);
+    uint64_t N = pts_.size();
+    ofs.write(sIdxMagic_, 8);
+    ofs.write((const char*)&fsz, sizeof(fsz));
+    ofs.write((const char*)&mt, sizeof(mt));
+    ofs.write((const char*)&N, sizeof(N));
+    ofs.write((const char*)pts_.data(), N*sizeof(double));
+    if(!ofs.good())
+        log_e("Video: failed to write '"+sfi+"', index not cached");
+    log_i("Video: index done, frames:"+to_string(N));
+    return true;
 }
-
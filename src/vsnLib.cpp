@@ -167,3 +167,10 @@ extern void vsn::show_loop()
 {
     while(!cv_waitESC(10));
 }
+//----
+extern void vsn::parallel_for(int N, 
+    const function<void(int i0, int i1)>& f)
+{
+    cv::parallel_for_(cv::Range(0, N), 
+        [&](const cv::Range& r){ f(r.start, r.end); });
+}
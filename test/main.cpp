@@ -16,6 +16,8 @@ namespace{
     //---- test list
     map<string, Sp<Test>> tests_
     {
+        {"img"      , mkSp<TestImg>()}, 
+        {"cam"      , mkSp<TestCam>()}, 
         {"marker"   , mkSp<TestMarker>()}, 
         {"feature"  , mkSp<TestFeature>()}, 
         {"stereo"   , mkSp<TestStereo>()}, 
@@ -0,0 +1,60 @@
+#include "vsn/vsnTest.h"
+#include "vsn/vsnLibCv.h"
+using namespace vsn;
+using namespace ut;
+using namespace test;
+
+namespace{
+    const struct{
+        int N = 20000;
+        double undis_TH = 0.1; // px, lookup vs solver
+    }lc_;
+}
+//--------------------------
+// Lookup grid against the iterative solver
+//   (lut_step 0) on a strongly distorted lens.
+bool TestCam::test_undis()const
+{
+    CamCfg cc;
+    cc.K << 500, 0, 320,
+            0, 500, 240,
+            0, 0, 1;
+    cc.D.k1 = -0.3; cc.D.k2 = 0.1;
+    cc.D.p1 = 0.001; cc.D.p2 = -0.001;
+    cc.sz = {640, 480};
+    cv::RNG rng;
+    vec2s vds;
+    for(int i=0;i<lc_.N;i++)
+    {
+        vec2 v; v << rng.uniform(0., 640.), rng.uniform(0., 480.);
+        vds.push_back(v);
+    }
+    //---- first call builds the grid
+    vec2s vs, vs0;
+    cc.undis(vds, vs);
+    vs.clear();
+    auto t0 = std::chrono::steady_clock::now();
+    cc.undis(vds, vs);
+    auto t1 = std::chrono::steady_clock::now();
+    CamCfg cc0 = cc;
+    cc0.lut_step = 0;
+    cc0.undis(vds, vs0);
+    auto t2 = std::chrono::steady_clock::now();
+    double e = 0;
+    for(int i=0;i<lc_.N;i++)
+        e = std::max(e, (vs[i] - vs0[i]).norm());
+    auto us = [](auto a, auto b){ return std::chrono::
+        duration_cast<std::chrono::microseconds>(b-a).count(); };
+    stringstream s;
+    s << "TestCam undis, N=" << lc_.N 
+      << ", lut " << us(t0, t1) << " us"
+      << ", solver " << us(t1, t2) << " us"
+      << ", max err " << e << " px";
+    log_i(s.str());
+    return e < lc_.undis_TH;
+}
+//--------------------------
+bool TestCam::run()
+{
+    return test_undis();
+}
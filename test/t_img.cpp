@@ -0,0 +1,94 @@
+#include "vsn/vsnTest.h"
+#include "vsn/vsnLibCv.h"
+using namespace vsn;
+using namespace ut;
+using namespace test;
+
+namespace{
+    //---- warpAffine reference, as Img::rot() had
+    cv::Mat rot_ref(const cv::Mat& im, double dgr)
+    {
+        cv::Point2f c((im.cols - 1)/2.0, (im.rows - 1)/2.0);
+        cv::Mat R = cv::getRotationMatrix2D(c, dgr, 1.0);
+        cv::Mat imr;
+        cv::warpAffine(im, imr, R, im.size());
+        return imr;
+    }
+}
+//--------------------------
+// Quarter turns must match warpAffine exactly, 
+//   other angles within interpolation rounding.
+bool TestImg::test_rot()const
+{
+    bool ok = true;
+    vector<cv::Size> szs{{640,480}, {480,480}, {641,480}};
+    vector<double> dgrs{90, 180, 270, -90, 450, 30, -12.5};
+    for(auto& sz : szs)
+    {
+        cv::Mat imc(sz, CV_8UC3);
+        cv::randu(imc, 0, 255);
+        for(auto d : dgrs)
+        {
+            ImgCv im(imc);
+            auto p = im.copy();
+            p->rot(d);
+            cv::Mat imr = ImgCv(*p).raw();
+            double e = cv::norm(imr, rot_ref(imc, d), cv::NORM_INF);
+            // exact unless w-h odd (remap fallback)
+            double a = std::fmod(std::abs(d), 180.0);
+            bool bQ = (a==0) || (a==90 && 
+                        (sz.width-sz.height)%2==0);
+            bool ok1 = bQ ? (e==0) : (e <= 2);
+            stringstream s;
+            s << "  rot " << sz.width << "x" << sz.height 
+              << " " << d << " dgr, max diff:" << e 
+              << (ok1 ? "" : " FAIL");
+            log_i(s.str());
+            ok &= ok1;
+        }
+    }
+    return ok;
+}
+//--------------------------
+// Fused ImgOps chain must match the eager
+//   Img calls on gray and HSV input too.
+bool TestImg::test_ops()const
+{
+    using C = Img::ClrSpc;
+    cv::Mat imc(480, 640, CV_8UC3);
+    cv::randu(imc, 0, 255);
+    ImgCv imb(imc);
+    imb.setClrSpc(C::BGR);
+    bool ok = true;
+    for(auto cs : {C::GRAY, C::HSV})
+    {
+        auto p_in = imb.as(cs)->copy();
+        //---- eager
+        auto pe = p_in->copy();
+        pe->toGray();
+        pe->blur(3);
+        pe->toHsv();
+        //---- fused
+        auto p_ops = ImgOps::create();
+        p_ops->toGray().blur(3).toHsv();
+        auto pf = p_ops->run(*p_in);
+        double e = -1;
+        if(pf!=nullptr && pf->clrSpc()==C::HSV)
+            e = cv::norm(ImgCv(*pf).raw(), ImgCv(*pe).raw(), 
+                         cv::NORM_INF);
+        bool ok1 = (e>=0) && (e<=1);
+        stringstream s;
+        s << "  ops from colour space " << (int)cs 
+          << ", max diff:" << e << (ok1 ? "" : " FAIL");
+        log_i(s.str());
+        ok &= ok1;
+    }
+    return ok;
+}
+//--------------------------
+bool TestImg::run()
+{
+    bool ok = test_rot();
+    ok &= test_ops();
+    return ok;
+}
@@ -21,8 +21,75 @@ namespace{
     //----
 }
 //--------------------------
+// Synthetic red/green/blue blocks with 
+//   speckles, both extraction modes 
+//   should find one instance per class.
+bool TestInst::test_cls()const
+{
+    cv::Mat imc(480, 640, CV_8UC3, cv::Scalar(0,0,0));
+    cv::rectangle(imc, cv::Rect(40, 40, 120, 80), {0,0,255}, -1);
+    cv::rectangle(imc, cv::Rect(240, 200, 100, 100), {0,255,0}, -1);
+    cv::rectangle(imc, cv::Rect(420, 300, 150, 60), {255,0,0}, -1);
+    for(int i=0;i<2000;i++)
+        imc.at<cv::Vec3b>(rand()%480, rand()%640) = {0,0,255};
+    ImgCv im(imc);
+
+    vsn::InstSegm inst;
+    auto& c = inst.cfg_;
+    c.areaTH = 50*50;
+    c.classes = {
+        {"red",   {{0,  150,150},{10, 255,255}}, false},
+        {"green", {{50, 150,150},{70, 255,255}}, false},
+        {"blue",  {{110,150,150},{130,255,255}}, false} };
+    bool ok = true;
+    for(int m=0;m<2;m++)
+    {
+        c.extract = m;
+        inst.onImg(im);
+        int n[3]{0,0,0};
+        for(auto& in : inst.data_.ins)
+            n[in.cls]++;
+        stringstream s;
+        s << "  extract mode " << m << ", instances r/g/b:" 
+            << n[0] << "/" << n[1] << "/" << n[2];
+        log_i(s.str());
+        ok &= (n[0]==1) && (n[1]==1) && (n[2]==1);
+    }
+    //---- tracking, green block moving 10 px
+    //   per frame, missed on frame 2. Velocity
+    //   after the gap must stay 10 px/frame.
+    vsn::InstSegm trk;
+    auto& tc = trk.cfg_;
+    tc.areaTH = 50*50;
+    tc.classes = { c.classes[1] };
+    tc.track.en = true;
+    vec2 vel = zerov2();
+    int id0 = -1;
+    for(int f=0;f<4;f++)
+    {
+        cv::Mat imf(480, 640, CV_8UC3, cv::Scalar(0,0,0));
+        if(f!=2)
+            cv::rectangle(imf, cv::Rect(240+f*10, 200, 100, 100), 
+                          {0,255,0}, -1);
+        trk.onImg(ImgCv(imf));
+        auto& ins = trk.data_.ins;
+        if(f==0 && ins.size()==1) id0 = ins[0].id;
+        if(f==3 && ins.size()==1 && ins[0].id==id0)
+            vel = ins[0].vel;
+    }
+    stringstream s;
+    s << "  track vel after missed frame: " 
+        << vel.x() << ", " << vel.y();
+    log_i(s.str());
+    ok &= (id0>=0) && (std::abs(vel.x()-10) < 1.5) && 
+          (std::abs(vel.y()) < 1.5);
+    return ok;
+}
+//--------------------------
 bool TestInst::run()
 {
+    if(!test_cls())
+        return false;
     auto p = vsn::Img::loadFile(lc_.sf_img);
     if(p==nullptr)
     {
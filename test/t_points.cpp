@@ -17,12 +17,87 @@ using namespace test;
 namespace{
     const struct{
         string sf_test = "points.pcd";
+        string sf_wr   = "points_wr.ply";
     }lc_;
 }
 //--------------------------
+// PointMap : same cloud fused twice at one
+//   pose keeps voxel count, evicted by N_max.
 bool TestPoints::test_basic()
 {
-    return true;
+    Points ps;
+    ps.gen_cylinder();
+    PointMap::Cfg c;
+    c.reso = 0.1;
+    auto p_map = PointMap::create(c);
+    auto& m = *p_map;
+    mat3 R = mat3::Identity();
+    vec3 t; t << 0,0,0;
+    m.add(ps, R, t);
+    size_t N = m.size();
+    m.add(ps, R, t);
+    bool ok = (N>0) && (m.size()==N) && 
+              (m.toPoints()->size()==N);
+    //---- shifted far, old voxels out
+    c.N_max = N;
+    p_map = PointMap::create(c);
+    p_map->add(ps, R, t);
+    t << 100,0,0;
+    p_map->add(ps, R, t);
+    ok &= (p_map->size()<=N);
+    auto pm = p_map->toPoints();
+    for(size_t i=0;i<pm->size();i++)
+        ok &= (pm->get(i).p.x() > 50);
+    if(!ok) log_e("TestPoints: PointMap check failed");
+    else log_i("TestPoints: PointMap voxels:"+to_string(N));
+    return ok;
+}
+//--------------------------
+// Grid filter : plane with a NaN hole holding
+//   two isolated points. Those must go, and
+//   must not skew the threshold of the rest.
+bool TestPoints::test_filter()
+{
+    int W = 40, H = 40;
+    auto gen = [&](Points& ps){
+        ps.initGrid(W, H);
+        for(int v=0;v<H;v++)
+            for(int u=0;u<W;u++)
+            {
+                bool bHole = (u>=30 && v>=30);
+                bool bIso = (u==32 && v==32) || 
+                            (u==37 && v==37);
+                if(bHole && !bIso) continue;
+                Points::Pnt p;
+                p.p << u*0.01, v*0.01, 1;
+                ps.set(u, v, p);
+            }
+    };
+    bool ok = true;
+    for(float devTh : {1.0f, 0.0f})
+    {
+        Points ps;
+        gen(ps);
+        Points::FilterCfg c;
+        c.mode = 1;
+        c.devTh = devTh;
+        ps.filter(c);
+        size_t N = ps.size();
+        bool bIso = false;
+        for(size_t i=0;i<N;i++)
+        {
+            vec3 p = ps.get(i).p;
+            bIso |= (p.x() > 0.295 && p.y() > 0.295);
+        }
+        stringstream s;
+        s << "TestPoints: grid filter devTh=" << devTh
+          << ", kept " << N << " of " << W*H-100;
+        log_i(s.str());
+        ok &= !bIso && (N > 0);
+        if(devTh>0) ok &= (N >= 1400);
+    }
+    if(!ok) log_e("TestPoints: grid filter check failed");
+    return ok;
 }
 
 //--------------------------
@@ -32,12 +107,22 @@ bool TestPoints::run()
     //test_pcl_wr();
     //test_pcl_vis();
     //---- test basic
-    bool ok = true;
+    bool ok = test_basic();
+    ok &= test_filter();
     Points pd;
     pd.gen_cylinder();
     ok &= pd.save(lc_.sf_test);
     Points pdr;
     ok &= pdr.load(lc_.sf_test);
+    //---- streamed in 2 chunks, read back
+    {
+        Points::Writer w;
+        ok &= w.open(lc_.sf_wr) && 
+              w.add(pd) && w.add(pd) && w.close();
+        Points pw;
+        ok &= pw.load(lc_.sf_wr) &&
+              pw.size()==2*pd.size();
+    }
 
     auto p_vis = Points::Vis::create();
     auto& vis = *p_vis;
@@ -23,22 +23,12 @@ namespace
         string sf_stereoc = "cfg/stereo.json";
         string sf_seqL    = "seq/image_0";
         string sf_seqR    = "seq/image_1";
+        // 'vsntool video pack' of the above, if present
+        string sf_pack    = "seq/image_01.vfrm";
+        // side by side stereo recording
+        string sf_sbs     = "seq/sbs.mp4";
 
     } lcfg_;
-    //--------------
-    //-------- get index from Kitti img filename
-    int getIdx(const string& sf)
-    {
-        string s= std::filesystem::path(sf).stem();
-        for(int i=0;i<s.length()-1;i++)
-        {
-            if(s[i]!='0') break;
-            s[i] = ' ';
-        }
-        
-        int i = std::stoi(s);
-        return i;
-    }
 
 }
 //--------------------------
@@ -46,9 +36,24 @@ bool TestStereo::testKittyGray()const
 {
     bool ok = true;
     log_i("run TestStereo()...");
-    vector<string> sfLs, sfRs;
-    cv::glob(lcfg_.sf_seqL, sfLs);
-    cv::glob(lcfg_.sf_seqR, sfRs);
+    //---- raw pack if present, else L/R 
+    //   decoded ahead, paired by index
+    Sp<FrmPack> p_pk = nullptr;
+    Sp<ImgSeq> p_seq = nullptr;
+    if(std::filesystem::exists(lcfg_.sf_pack))
+        p_pk = FrmPack::open(lcfg_.sf_pack);
+    if(p_pk==nullptr)
+    {
+        ImgSeq::Cfg sc;
+        sc.cvFlag = cv::IMREAD_GRAYSCALE;
+        p_seq = ImgSeq::create(lcfg_.sf_seqL, sc, lcfg_.sf_seqR);
+        if(p_seq==nullptr)
+            return false;
+    }
+    auto readLR = [&](Sp<Img>& p1, Sp<Img>& p2)
+    { return p_pk ? p_pk->readLR(p1, p2) : p_seq->readLR(p1, p2); };
+    auto frmIdx = [&]()
+    { return p_pk ? p_pk->frmIdx() : p_seq->frmIdx(); };
     CamCfg camc;
     if (!camc.load(lcfg_.sf_camc))
         return false;
@@ -62,30 +67,24 @@ bool TestStereo::testKittyGray()const
     vo.cfg_.camc = camc;
 
     //---- main loop
-    int N = sfLs.size();
-    if (N > sfRs.size())
-        N = sfRs.size();
+    int N = p_pk ? p_pk->size() : p_seq->size();
     log_i("seq has total imgs:" + to_string(N));
 
     //-----
     for (int i = 0; i < N; i++)
     {
         //---- load image
-        int lf = cv::IMREAD_GRAYSCALE;
-
-        auto p1 = Img::loadFile(sfLs[i], lf);
-        auto p2 = Img::loadFile(sfRs[i], lf);
-        if ((p1 == nullptr) || (p2 == nullptr))
+        Sp<Img> p1, p2;
+        if (!readLR(p1, p2))
         {
-            log_e("Failed load image '" +
-                  sfLs[i] + "' or '" + sfRs[i] + "'");
+            log_e("Failed load image pair:" + to_string(i));
             return false;
         }
         auto &im1 = *p1;
         auto &im2 = *p2;
 
         //--- process img
-        int fi = getIdx(sfLs[i]);
+        int fi = frmIdx();
         vo.setFrmIdx(fi);
         vo.onImg(im1, im2);
 
@@ -95,7 +94,7 @@ bool TestStereo::testKittyGray()const
         cv::Mat Rw, tw;
         cv::eigen2cv(odom.Rw, Rw);
         cv::eigen2cv(odom.tw, tw);
-        int idx = getIdx(sfLs[i]);
+        int idx = frmIdx();
         oftw << kitti_line(Rw, tw, idx);
         */
         //--- write points
@@ -119,10 +118,52 @@ bool TestStereo::testKittyGray()const
     return ok;
 }
 
+//--------------------------
+// Side by side video, L/R views straight 
+//   into StereoVO.
+bool TestStereo::test_sbsVideo()const
+{
+    if(!std::filesystem::exists(lcfg_.sf_sbs))
+    {
+        log_i("TestStereo: no '"+lcfg_.sf_sbs+
+              "', side by side test skipped");
+        return true;
+    }
+    CamCfg camc;
+    if (!camc.load(lcfg_.sf_camc))
+        return false;
+    auto p_vo = StereoVO::create();
+    auto& vo = *p_vo;
+    if (!vo.cfg_.load(lcfg_.sf_stereoc))
+        return false;
+    vo.cfg_.camc = camc;
+    //----
+    StereoVideo::Cfg sc;
+    sc.enUndist = true;
+    sc.camL = sc.camR = camc;
+    Video::Cfg vc;
+    vc.async.en = true;
+    auto p_sv = StereoVideo::open(lcfg_.sf_sbs, sc, vc);
+    if(p_sv==nullptr)
+        return false;
+    Sp<Img> pL, pR;
+    while(p_sv->read(pL, pR))
+    {
+        vo.setFrmIdx((int)pL->frm.idx);
+        vo.onImg(*pL, *pR);
+        char c = (char)cv::waitKey(1);
+        if (c == 27)
+            break;
+    }
+    vo.onFinish();
+    return true;
+}
 //----------
 bool TestStereo::run()
 {
   //  return testKittyGray();    
-    return test_imgLR();    
+    if(!test_imgLR())
+        return false;
+    return test_sbsVideo();
 }
 